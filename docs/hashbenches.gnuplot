@@ -0,0 +1,17 @@
+# Redraws hashbenches-skylake-clang.png from the output of hashbenchmark:
+#   ./hashbenchmark chart --size 100000000 > hashbenches.csv
+#   gnuplot docs/hashbenches.gnuplot
+# The chart is written to hashbenches.png in the current directory.
+set terminal pngcairo size 750,450 font ",12"
+set output "hashbenches.png"
+set datafile separator ","
+set key bottom right
+set grid
+set xlabel "divisor"
+set ylabel "time (s)"
+set xrange [3:64]
+set yrange [0:*]
+data = "< grep '^chart,' hashbenches.csv"
+plot data using 2:3 with lines lw 3 lc rgb "red" title "division instruction", \
+     data using 2:4 with lines lw 3 lc rgb "#4daf4a" title "compiler", \
+     data using 2:6 with lines lw 3 lc rgb "blue" title "our approach (LKK)"
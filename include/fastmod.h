@@ -5,7 +5,9 @@
 #include <stdbool.h>
 #include <stdint.h>
 #else
+#include <cstddef>
 #include <cstdint>
+#include <type_traits>
 #endif
 
 #ifndef __cplusplus
@@ -24,6 +26,13 @@
 #endif
 #endif
 
+// constant tables, usable at compile time when the functions are
+#if defined(__cplusplus) && __cpp_constexpr >= 201304 && !defined(_MSC_VER)
+#define FASTMOD_TABLE constexpr
+#else
+#define FASTMOD_TABLE static const
+#endif
+
 #ifdef _MSC_VER
 #include <intrin.h>
 #endif
@@ -169,9 +178,365 @@ FASTMOD_API uint32_t fastdiv_u32(uint32_t a, uint64_t M) {
   return (uint32_t)(mul128_u32(M, a));
 }
 
+// fastdivmod computes (a / d) and stores (a % d) in *remainder given
+// precomputed M for d>1
+FASTMOD_API uint32_t fastdivmod_u32(uint32_t a, uint64_t M, uint32_t d,
+                                    uint32_t *remainder) {
+  uint32_t q = fastdiv_u32(a, M);
+  // a 32-bit multiply is cheaper than a second 64-bit high multiply
+  *remainder = a - q * d;
+  return q;
+}
+
 // given precomputed M, is_divisible checks whether n % d == 0
 FASTMOD_API bool is_divisible(uint32_t n, uint64_t M) { return n * M <= M - 1; }
 
+/**
+ * 16-bit and 8-bit unsigned integers.
+ * Usage:
+ *  uint16_t d = ... ; // divisor, should be non-zero
+ *  uint32_t M = computeM_u16(d); // do once
+ *  fastmod_u16(a,M,d) is a % d for all 16-bit a.
+ *  fastdiv_u16(a,M) is a / d for all 16-bit a, d > 1.
+ *  is_divisible_u16(a,M) is true when a % d == 0.
+ *
+ *  uint8_t d8 = ... ; // divisor, should be non-zero
+ *  uint16_t M8 = computeM_u8(d8); // do once
+ *  fastmod_u8(a,M8,d8), fastdiv_u8(a,M8) and is_divisible_u8(a,M8) likewise.
+ *
+ * The magic numbers have twice as many bits as the dividends, like M for
+ * computeM_u32, so that the products fit in 32-bit (8-bit) or 64-bit
+ * (16-bit) integers. See fastmod_u16_batch in fastmod_batch.h for arrays.
+ **/
+
+// M = ceil( (1<<32) / d ), d > 0
+FASTMOD_API uint32_t computeM_u16(uint16_t d) {
+  return UINT32_C(0xFFFFFFFF) / d + 1;
+}
+
+// fastmod computes (a % d) given precomputed M
+FASTMOD_API uint16_t fastmod_u16(uint16_t a, uint32_t M, uint16_t d) {
+  uint32_t lowbits = M * a;
+  return (uint16_t)(((uint64_t)lowbits * d) >> 32);
+}
+
+// fastdiv computes (a / d) given precomputed M for d>1
+FASTMOD_API uint16_t fastdiv_u16(uint16_t a, uint32_t M) {
+  return (uint16_t)(((uint64_t)M * a) >> 32);
+}
+
+// given precomputed M, is_divisible_u16 checks whether n % d == 0
+FASTMOD_API bool is_divisible_u16(uint16_t n, uint32_t M) {
+  return n * M <= M - 1;
+}
+
+// M = ceil( (1<<16) / d ), d > 0
+FASTMOD_API uint16_t computeM_u8(uint8_t d) {
+  return (uint16_t)(UINT32_C(0xFFFF) / d + 1);
+}
+
+// fastmod computes (a % d) given precomputed M
+FASTMOD_API uint8_t fastmod_u8(uint8_t a, uint16_t M, uint8_t d) {
+  uint16_t lowbits = (uint16_t)((uint32_t)M * a);
+  return (uint8_t)(((uint32_t)lowbits * d) >> 16);
+}
+
+// fastdiv computes (a / d) given precomputed M for d>1
+FASTMOD_API uint8_t fastdiv_u8(uint8_t a, uint16_t M) {
+  return (uint8_t)(((uint32_t)M * a) >> 16);
+}
+
+// given precomputed M, is_divisible_u8 checks whether n % d == 0
+FASTMOD_API bool is_divisible_u8(uint8_t n, uint16_t M) {
+  return (uint16_t)((uint32_t)n * M) <= (uint16_t)(M - 1);
+}
+
+/**
+ * Computing M without a division instruction.
+ * Usage:
+ *  computeM_u32_nodiv(d) is computeM_u32(d) for all 32-bit d > 0.
+ *
+ * When the divisors change often, the 64-bit division in computeM_u32 can
+ * dominate. Instead, d is shifted left until its top bit is set (dn) and
+ * the reciprocal v = floor((2^64 - 1) / dn) - 2^32 is found from a table
+ * indexed by the top 10 bits of dn, two Newton steps and a final
+ * correction. Dividing 2^64 - 1 by d then takes two steps of the 2-by-1
+ * division of Moller and Granlund ("Improved division by invariant
+ * integers", 2011), with multiplications only. See computeM_u32_batch in
+ * fastmod_batch.h for whole arrays of divisors.
+ **/
+
+// floor(2^26 / (i + 513)), a lower bound on 2^16 / a for the normalized
+// divisors a = dn / 2^32 whose top 10 bits are 512 + i
+FASTMOD_TABLE uint32_t fastmod_reciprocal_table[512] = {
+    130816, 130561, 130308, 130055, 129804, 129553, 129304, 129055,
+    128807, 128561, 128315, 128070, 127826, 127583, 127341, 127100,
+    126859, 126620, 126382, 126144, 125907, 125672, 125437, 125203,
+    124969, 124737, 124506, 124275, 124045, 123817, 123589, 123361,
+    123135, 122910, 122685, 122461, 122238, 122016, 121794, 121574,
+    121354, 121135, 120916, 120699, 120482, 120266, 120051, 119837,
+    119623, 119410, 119198, 118987, 118776, 118566, 118357, 118149,
+    117941, 117734, 117528, 117323, 117118, 116914, 116711, 116508,
+    116306, 116105, 115904, 115704, 115505, 115307, 115109, 114912,
+    114716, 114520, 114325, 114130, 113936, 113743, 113551, 113359,
+    113168, 112977, 112788, 112598, 112410, 112222, 112034, 111848,
+    111662, 111476, 111291, 111107, 110923, 110740, 110558, 110376,
+    110195, 110014, 109834, 109655, 109476, 109297, 109120, 108942,
+    108766, 108590, 108414, 108240, 108065, 107892, 107718, 107546,
+    107374, 107202, 107031, 106861, 106691, 106522, 106353, 106184,
+    106017, 105849, 105683, 105517, 105351, 105186, 105021, 104857,
+    104694, 104530, 104368, 104206, 104044, 103883, 103723, 103563,
+    103403, 103244, 103085, 102927, 102770, 102612, 102456, 102300,
+    102144, 101989, 101834, 101680, 101526, 101372, 101220, 101067,
+    100915, 100764, 100612, 100462, 100312, 100162, 100013, 99864,
+    99715, 99568, 99420, 99273, 99126, 98980, 98834, 98689,
+    98544, 98400, 98256, 98112, 97969, 97826, 97683, 97541,
+    97400, 97259, 97118, 96978, 96838, 96698, 96559, 96420,
+    96282, 96144, 96006, 95869, 95733, 95596, 95460, 95325,
+    95189, 95055, 94920, 94786, 94652, 94519, 94386, 94254,
+    94121, 93990, 93858, 93727, 93596, 93466, 93336, 93206,
+    93077, 92948, 92820, 92691, 92563, 92436, 92309, 92182,
+    92056, 91929, 91804, 91678, 91553, 91428, 91304, 91180,
+    91056, 90933, 90810, 90687, 90565, 90443, 90321, 90200,
+    90079, 89958, 89837, 89717, 89597, 89478, 89359, 89240,
+    89121, 89003, 88885, 88768, 88651, 88534, 88417, 88301,
+    88185, 88069, 87953, 87838, 87724, 87609, 87495, 87381,
+    87267, 87154, 87041, 86928, 86816, 86703, 86592, 86480,
+    86369, 86258, 86147, 86037, 85926, 85816, 85707, 85598,
+    85488, 85380, 85271, 85163, 85055, 84947, 84840, 84733,
+    84626, 84519, 84413, 84307, 84201, 84096, 83991, 83886,
+    83781, 83676, 83572, 83468, 83365, 83261, 83158, 83055,
+    82952, 82850, 82748, 82646, 82544, 82443, 82342, 82241,
+    82140, 82040, 81940, 81840, 81740, 81640, 81541, 81442,
+    81344, 81245, 81147, 81049, 80951, 80854, 80756, 80659,
+    80562, 80466, 80369, 80273, 80177, 80082, 79986, 79891,
+    79796, 79701, 79607, 79512, 79418, 79324, 79231, 79137,
+    79044, 78951, 78858, 78766, 78673, 78581, 78489, 78398,
+    78306, 78215, 78124, 78033, 77942, 77852, 77762, 77672,
+    77582, 77492, 77403, 77314, 77225, 77136, 77048, 76959,
+    76871, 76783, 76695, 76608, 76520, 76433, 76346, 76260,
+    76173, 76087, 76000, 75915, 75829, 75743, 75658, 75573,
+    75488, 75403, 75318, 75234, 75149, 75065, 74981, 74898,
+    74814, 74731, 74648, 74565, 74482, 74400, 74317, 74235,
+    74153, 74071, 73989, 73908, 73827, 73746, 73665, 73584,
+    73503, 73423, 73343, 73262, 73183, 73103, 73023, 72944,
+    72865, 72786, 72707, 72628, 72550, 72471, 72393, 72315,
+    72237, 72160, 72082, 72005, 71928, 71851, 71774, 71697,
+    71620, 71544, 71468, 71392, 71316, 71240, 71165, 71089,
+    71014, 70939, 70864, 70789, 70715, 70640, 70566, 70492,
+    70418, 70344, 70271, 70197, 70124, 70051, 69977, 69905,
+    69832, 69759, 69687, 69615, 69542, 69470, 69399, 69327,
+    69255, 69184, 69113, 69042, 68971, 68900, 68829, 68759,
+    68688, 68618, 68548, 68478, 68408, 68338, 68269, 68200,
+    68130, 68061, 67992, 67923, 67855, 67786, 67718, 67650,
+    67581, 67513, 67446, 67378, 67310, 67243, 67176, 67108,
+    67041, 66974, 66908, 66841, 66774, 66708, 66642, 66576,
+    66510, 66444, 66378, 66313, 66247, 66182, 66117, 66052,
+    65987, 65922, 65857, 65793, 65728, 65664, 65600, 65536,
+};
+
+// v = floor((2^64 - 1) / dn) - 2^32 for 2^31 <= dn < 2^32
+FASTMOD_API uint32_t fastmod_reciprocal_u32(uint32_t dn) {
+  // y0 = t / 2^16 is within 2^-9 of 1 / a, below it
+  const uint64_t t = fastmod_reciprocal_table[(dn >> 22) & 0x1FF];
+  // y1 = y0 (2 - a y0) = 1 + v1 / 2^32 is within 2^-18 of 1 / a, below it,
+  // with e = 2^48 (1 - a y0) < 2^40
+  const uint64_t e = (UINT64_C(1) << 48) - dn * t;
+  const uint32_t v1 =
+      (uint32_t)((t << 16) + ((t * e) >> 32) - (UINT64_C(1) << 32));
+  // y2 = y1 (2 - a y1) with x = 2^48 (1 - a y1) < 2^31
+  const uint64_t x = (0 - ((uint64_t)dn << 32) - (uint64_t)dn * v1) >> 16;
+  uint32_t v = v1 + (uint32_t)(((x << 32) + (uint64_t)v1 * x) >> 48);
+  // every step rounds down, at most one unit is missing
+  const uint64_t r = ~(((uint64_t)dn << 32) + (uint64_t)dn * v);
+  return v + (r >= dn ? 1 : 0); // r = 2^64 - 1 - (2^32 + v) dn
+}
+
+// q = floor((u1 2^32 + u0) / dn) and *remainder = the remainder, for u1 < dn,
+// 2^31 <= dn and v = fastmod_reciprocal_u32(dn)
+FASTMOD_API uint32_t fastmod_div_2by1_u32(uint32_t u1, uint32_t u0,
+                                          uint32_t dn, uint32_t v,
+                                          uint32_t *remainder) {
+  const uint64_t p = (uint64_t)v * u1 + (((uint64_t)u1 << 32) | u0);
+  uint32_t q = (uint32_t)(p >> 32) + 1;
+  uint32_t r = u0 - q * dn;
+  // q is often one too large, a mask is cheaper than a mispredicted branch
+  const uint32_t mask = 0 - (uint32_t)(r > (uint32_t)p ? 1 : 0);
+  q += mask;
+  r += dn & mask;
+  if (r >= dn) { // rarely
+    q++;
+    r -= dn;
+  }
+  *remainder = r;
+  return q;
+}
+
+// computeM_u32 with multiplications only, d > 0
+FASTMOD_API uint64_t computeM_u32_nodiv(uint32_t d) {
+  int s = 0;
+#if defined(__GNUC__) || defined(__clang__)
+  s = __builtin_clz(d | 1); // the same for d > 0
+#else
+  for (int k = 16; k > 0; k /= 2) {
+    if ((d << s) >> (32 - k) == 0)
+      s += k;
+  }
+#endif
+  const uint32_t dn = d << s;
+  const uint32_t v = fastmod_reciprocal_u32(dn);
+  // (2^64 - 1) 2^s / dn in two steps, the top word 2^s - 1 is below dn
+  uint32_t r = 0;
+  const uint32_t q1 = fastmod_div_2by1_u32((uint32_t)((UINT64_C(1) << s) - 1),
+                                           0xFFFFFFFF, dn, v, &r);
+  const uint32_t q0 =
+      fastmod_div_2by1_u32(r, (uint32_t)(UINT64_C(0xFFFFFFFF) << s), dn, v, &r);
+  return (((uint64_t)q1 << 32) | q0) + 1;
+}
+
+/**
+ * Multiply-shift range reduction ("fastrange").
+ * Usage:
+ *  uint32_t d = ... ; // any value, no precomputation is needed
+ *  fastrange32(x,d) is in [0, d) for all 32-bit x.
+ *
+ * The result is not x % d, but each value in [0, d) is hit by either
+ * floor(2^32 / d) or ceil(2^32 / d) values of x. It is a fair map for
+ * hashing when the low bits of x are as good as the high bits.
+ **/
+
+// fastrange32 maps x to floor(x * d / 2^32), in [0, d) when d > 0
+FASTMOD_API uint32_t fastrange32(uint32_t x, uint32_t d) {
+  return (uint32_t)(((uint64_t)x * d) >> 32);
+}
+
+// fastrange64 maps x to floor(x * d / 2^64), in [0, d) when d > 0
+FASTMOD_API uint64_t fastrange64(uint64_t x, uint64_t d) {
+  return mul128_from_u64(x, d);
+}
+
+/**
+ * 64-bit unsigned dividends with 32-bit unsigned divisors.
+ * Usage:
+ *  uint32_t d = ... ; // divisor, should be greater than one
+ *  uint64_t M = computeM_u32(d); // do once, same M as for fastmod_u32
+ *  fastmod_u64_u32(a,M,d) is a % d for all 64-bit a.
+ *  fastdiv_u64_u32(a,M,d) is a / d for all 64-bit a.
+ *
+ * With a 64-bit M, floor(M * a / 2^64) is either a / d or a / d + 1, so we
+ * compute the remainder from this estimate and correct it once. There is
+ * no need for the 128-bit M of computeM_u64.
+ **/
+
+// fastmod computes (a % d) given precomputed M for d>1
+FASTMOD_API uint32_t fastmod_u64_u32(uint64_t a, uint64_t M, uint32_t d) {
+  // if the estimate is one too large, the subtraction wraps around
+  uint64_t r = a - mul128_from_u64(a, M) * d;
+  return (uint32_t)(r >= d ? r + d : r);
+}
+
+// fastdiv computes (a / d) given precomputed M for d>1
+FASTMOD_API uint64_t fastdiv_u64_u32(uint64_t a, uint64_t M, uint32_t d) {
+  uint64_t q = mul128_from_u64(a, M);
+  uint64_t r = a - q * d;
+  return r >= d ? q - 1 : q;
+}
+
+// fastdivmod computes (a / d) and stores (a % d) in *remainder given
+// precomputed M for d>1
+FASTMOD_API uint64_t fastdivmod_u64_u32(uint64_t a, uint64_t M, uint32_t d,
+                                        uint32_t *remainder) {
+  uint64_t q = mul128_from_u64(a, M);
+  uint64_t r = a - q * d;
+  if (r >= d) {
+    q--;
+    r += d;
+  }
+  *remainder = (uint32_t)r;
+  return q;
+}
+
+/**
+ * Modular multiplication with 32-bit moduli.
+ * Usage:
+ *  uint32_t p = ... ; // modulus, should be greater than one
+ *  uint64_t M = computeM_u32(p); // do once
+ *  mulmod_u32(a,b,M,p) is (a * b) % p for all 32-bit a and b.
+ *
+ * When b is fixed and b < p, a Shoup-style precomputation saves the
+ * 64-bit high multiply:
+ *  uint32_t bM = computeM_mulmod_u32(b,M,p); // do once per b
+ *  mulmod_precomp_u32(a,b,bM,p) is (a * b) % p for all 32-bit a.
+ **/
+
+// mulmod computes (a * b) % p given precomputed M for p>1
+FASTMOD_API uint32_t mulmod_u32(uint32_t a, uint32_t b, uint64_t M,
+                                uint32_t p) {
+  return fastmod_u64_u32((uint64_t)a * b, M, p);
+}
+
+// bM = floor(b * 2^32 / p), requires b < p and p>1
+FASTMOD_API uint32_t computeM_mulmod_u32(uint32_t b, uint64_t M, uint32_t p) {
+  return (uint32_t)fastdiv_u64_u32((uint64_t)b << 32, M, p);
+}
+
+// mulmod_precomp computes (a * b) % p given bM = computeM_mulmod_u32(b,M,p)
+FASTMOD_API uint32_t mulmod_precomp_u32(uint32_t a, uint32_t b, uint32_t bM,
+                                        uint32_t p) {
+  // q is floor(a * b / p) or one less, so r is in [0, 2p)
+  uint64_t q = ((uint64_t)a * bM) >> 32;
+  uint64_t r = (uint64_t)a * b - q * p;
+  return (uint32_t)(r >= p ? r - p : r);
+}
+
+// powmod computes (a ^ e) % p given precomputed M for p>1
+FASTMOD_API uint32_t powmod_u32(uint32_t a, uint32_t e, uint64_t M,
+                                uint32_t p) {
+  uint32_t result = 1;
+  while (e != 0) {
+    if (e & 1)
+      result = mulmod_u32(result, a, M, p);
+    a = mulmod_u32(a, a, M, p);
+    e >>= 1;
+  }
+  return result;
+}
+
+// is_prime_u32 tells you whether n is prime, it runs a deterministic
+// Miller-Rabin test with the bases 2, 7 and 61 (enough for n < 4759123141)
+FASTMOD_API bool is_prime_u32(uint32_t n) {
+  if (n < 4)
+    return n >= 2;
+  if ((n & 1) == 0)
+    return false;
+  uint64_t M = computeM_u32(n);
+  // n - 1 = odd * 2^s
+  uint32_t odd = n - 1;
+  int s = 0;
+  while ((odd & 1) == 0) {
+    odd >>= 1;
+    s++;
+  }
+  const uint32_t bases[3] = {2, 7, 61};
+  for (int i = 0; i < 3; i++) {
+    uint32_t a = fastmod_u32(bases[i], M, n);
+    if (a == 0)
+      continue; // n divides the base, so n is the base: prime
+    uint32_t x = powmod_u32(a, odd, M, n);
+    if ((x == 1) || (x == n - 1))
+      continue;
+    int j = 1;
+    for (; j < s; j++) {
+      x = mulmod_u32(x, x, M, n);
+      if (x == n - 1)
+        break;
+    }
+    if (j == s)
+      return false;
+  }
+  return true;
+}
+
 /**
  * signed integers
  * Usage:
@@ -208,12 +573,96 @@ FASTMOD_API int32_t fastdiv_s32(int32_t a, uint64_t M, int32_t d) {
   return (int32_t)(highbits);
 }
 
+// fastdivmod computes (a / d) and stores (a % d) in *remainder given a
+// precomputed M, same constraints as fastdiv_s32
+FASTMOD_API int32_t fastdivmod_s32(int32_t a, uint64_t M, int32_t d,
+                                   int32_t *remainder) {
+  int32_t q = fastdiv_s32(a, M, d);
+  *remainder = (int32_t)((uint32_t)a - (uint32_t)q * (uint32_t)d);
+  return q;
+}
+
 // What follows is the 64-bit functions.
 // They may not be faster than what the compiler can produce.
 
 #ifndef _MSC_VER
 // No __uint128_t in VS, so they have to use a diffrent method.
 
+// Same name as the struct used under Visual Studio, so that code handling
+// 64-bit magic numbers can be written once.
+typedef __uint128_t fastmod_u128_t;
+
+// floor((2^19 - 3 2^8) / (i + 256)), an 11-bit approximation of 2^10 / a for
+// the normalized divisors a = dn / 2^64 whose top 9 bits are 256 + i
+FASTMOD_TABLE uint16_t fastmod_reciprocal_table_u64[256] = {
+    2045, 2037, 2029, 2021, 2013, 2005, 1998, 1990, 1983, 1975,
+    1968, 1960, 1953, 1946, 1938, 1931, 1924, 1917, 1910, 1903,
+    1896, 1889, 1883, 1876, 1869, 1863, 1856, 1849, 1843, 1836,
+    1830, 1824, 1817, 1811, 1805, 1799, 1792, 1786, 1780, 1774,
+    1768, 1762, 1756, 1750, 1745, 1739, 1733, 1727, 1722, 1716,
+    1710, 1705, 1699, 1694, 1688, 1683, 1677, 1672, 1667, 1661,
+    1656, 1651, 1646, 1641, 1636, 1630, 1625, 1620, 1615, 1610,
+    1605, 1600, 1596, 1591, 1586, 1581, 1576, 1572, 1567, 1562,
+    1558, 1553, 1548, 1544, 1539, 1535, 1530, 1526, 1521, 1517,
+    1513, 1508, 1504, 1500, 1495, 1491, 1487, 1483, 1478, 1474,
+    1470, 1466, 1462, 1458, 1454, 1450, 1446, 1442, 1438, 1434,
+    1430, 1426, 1422, 1418, 1414, 1411, 1407, 1403, 1399, 1396,
+    1392, 1388, 1384, 1381, 1377, 1374, 1370, 1366, 1363, 1359,
+    1356, 1352, 1349, 1345, 1342, 1338, 1335, 1332, 1328, 1325,
+    1322, 1318, 1315, 1312, 1308, 1305, 1302, 1299, 1295, 1292,
+    1289, 1286, 1283, 1280, 1276, 1273, 1270, 1267, 1264, 1261,
+    1258, 1255, 1252, 1249, 1246, 1243, 1240, 1237, 1234, 1231,
+    1228, 1226, 1223, 1220, 1217, 1214, 1211, 1209, 1206, 1203,
+    1200, 1197, 1195, 1192, 1189, 1187, 1184, 1181, 1179, 1176,
+    1173, 1171, 1168, 1165, 1163, 1160, 1158, 1155, 1153, 1150,
+    1148, 1145, 1143, 1140, 1138, 1135, 1133, 1130, 1128, 1125,
+    1123, 1121, 1118, 1116, 1113, 1111, 1109, 1106, 1104, 1102,
+    1099, 1097, 1095, 1092, 1090, 1088, 1086, 1083, 1081, 1079,
+    1077, 1074, 1072, 1070, 1068, 1066, 1064, 1061, 1059, 1057,
+    1055, 1053, 1051, 1049, 1047, 1044, 1042, 1040, 1038, 1036,
+    1034, 1032, 1030, 1028, 1026, 1024,
+};
+
+// v = floor((2^128 - 1) / dn) - 2^64 for 2^63 <= dn, this is RECIPROCAL_WORD
+// from Moller and Granlund ("Improved division by invariant integers", 2011)
+FASTMOD_API uint64_t fastmod_reciprocal_u64(uint64_t dn) {
+  const uint64_t d0 = dn & 1;
+  const uint64_t d40 = (dn >> 24) + 1;
+  const uint64_t d63 = (dn >> 1) + d0; // ceil(dn / 2)
+  const uint64_t v0 = fastmod_reciprocal_table_u64[(dn >> 55) - 256];
+  // Newton steps on fewer bits, then a final one on 64 bits
+  const uint64_t v1 = (v0 << 11) - ((v0 * v0 * d40) >> 40) - 1;
+  const uint64_t v2 =
+      (v1 << 13) + ((v1 * ((UINT64_C(1) << 60) - v1 * d40)) >> 47);
+  const uint64_t e = ((v2 >> 1) & (0 - d0)) - v2 * d63;
+  const uint64_t v3 =
+      (v2 << 31) + ((uint64_t)(((__uint128_t)v2 * e) >> 64) >> 1);
+  // v3 is v or v - 1
+  const __uint128_t p = (__uint128_t)v3 * dn + dn;
+  return v3 - (uint64_t)(p >> 64) - dn;
+}
+
+// q = floor((u1 2^64 + u0) / dn) and *remainder = the remainder, for u1 < dn,
+// 2^63 <= dn and v = fastmod_reciprocal_u64(dn)
+FASTMOD_API uint64_t fastmod_div_2by1_u64(uint64_t u1, uint64_t u0,
+                                          uint64_t dn, uint64_t v,
+                                          uint64_t *remainder) {
+  const __uint128_t p =
+      (__uint128_t)v * u1 + (((__uint128_t)u1 << 64) | u0);
+  uint64_t q = (uint64_t)(p >> 64) + 1;
+  uint64_t r = u0 - q * dn;
+  // q is often one too large, a mask is cheaper than a mispredicted branch
+  const uint64_t mask = 0 - (uint64_t)(r > (uint64_t)p ? 1 : 0);
+  q += mask;
+  r += dn & mask;
+  if (r >= dn) { // rarely
+    q++;
+    r -= dn;
+  }
+  *remainder = r;
+  return q;
+}
+
 FASTMOD_API __uint128_t computeM_u64(uint64_t d) {
   // what follows is just ((__uint128_t)0 - 1) / d) + 1 spelled out
   __uint128_t M = UINT64_C(0xFFFFFFFFFFFFFFFF);
@@ -224,6 +673,31 @@ FASTMOD_API __uint128_t computeM_u64(uint64_t d) {
   return M;
 }
 
+// computeM_u64(d) with multiplications only, for d > 0: GCC and clang call
+// __udivti3 for the 128-bit division in computeM_u64, which is slow where
+// the hardware divq is slow or absent
+FASTMOD_API __uint128_t computeM_u64_nodiv(uint64_t d) {
+  int s = 0;
+#if defined(__GNUC__) || defined(__clang__)
+  s = __builtin_clzll(d | 1); // the same for d > 0
+#else
+  for (int k = 32; k > 0; k /= 2) {
+    if ((d << s) >> (64 - k) == 0)
+      s += k;
+  }
+#endif
+  const uint64_t dn = d << s;
+  const uint64_t v = fastmod_reciprocal_u64(dn);
+  // (2^128 - 1) 2^s / dn in two steps, the top word 2^s - 1 is below dn
+  uint64_t r = 0;
+  const uint64_t q1 = fastmod_div_2by1_u64((UINT64_C(1) << s) - 1,
+                                           UINT64_C(0xFFFFFFFFFFFFFFFF), dn, v,
+                                           &r);
+  const uint64_t q0 = fastmod_div_2by1_u64(
+      r, UINT64_C(0xFFFFFFFFFFFFFFFF) << s, dn, v, &r);
+  return (((__uint128_t)q1 << 64) | q0) + 1;
+}
+
 FASTMOD_API uint64_t fastmod_u64(uint64_t a, __uint128_t M, uint64_t d) {
   __uint128_t lowbits = M * a;
   return mul128_u64(lowbits, d);
@@ -236,6 +710,54 @@ FASTMOD_API uint64_t fastdiv_u64(uint64_t a, __uint128_t M) {
 // given precomputed M, is_divisible checks whether n % d == 0
 FASTMOD_API bool is_divisible_u64(uint64_t n, __uint128_t M) { return n * M <= M - 1; }
 
+// M = floor( (1<<128) / d ) + 1
+// you must have that d is different from 0 and -9223372036854775808
+FASTMOD_API __uint128_t computeM_s64(int64_t d) {
+  if (d < 0)
+    d = -d;
+  return computeM_u64(d) + ((d & (d - 1)) == 0 ? 1 : 0);
+}
+
+// fastmod computes (a % d) given precomputed M,
+// you should pass the absolute value of d
+FASTMOD_API int64_t fastmod_s64(int64_t a, __uint128_t M, int64_t positive_d) {
+  __uint128_t lowbits = M * a;
+  int64_t highbits = (int64_t)mul128_u64(lowbits, positive_d);
+  return highbits - ((positive_d - 1) & (a >> 63));
+}
+
+// Returns the highest 64 bits of M * a for a signed a (mul128_s32 for the
+// 64-bit functions)
+FASTMOD_API uint64_t mul128_s64(__uint128_t M, int64_t a) {
+  uint64_t M_lo = (uint64_t)M;
+  uint64_t M_hi = (uint64_t)(M >> 64);
+  // floor(M_lo * a / 2^64), between -2^64 and 2^64
+  __int128 bottom_half = (__int128)(((__uint128_t)M_lo * (uint64_t)a) >> 64);
+  if (a < 0)
+    bottom_half -= M_lo;
+  __int128 top_half = (__int128)M_hi * a;
+  return (uint64_t)((top_half + bottom_half) >> 64);
+}
+
+// mulmod computes (a * b) % p given precomputed M = computeM_u64(p) for
+// p>1, you must have that a < p
+FASTMOD_API uint64_t mulmod_u64(uint64_t a, uint64_t b, __uint128_t M,
+                                uint64_t p) {
+  __uint128_t x = (__uint128_t)a * b;
+  uint64_t x_lo = (uint64_t)x;
+  uint64_t x_hi = (uint64_t)(x >> 64);
+  uint64_t M_lo = (uint64_t)M;
+  uint64_t M_hi = (uint64_t)(M >> 64);
+  // q = floor(x * M / 2^128) is floor(x / p) or one more, since x < p 2^64
+  __uint128_t middle = (__uint128_t)x_hi * M_lo + mul128_from_u64(x_lo, M_lo);
+  __uint128_t other_middle = (__uint128_t)x_lo * M_hi + (uint64_t)middle;
+  uint64_t q = x_hi * M_hi + (uint64_t)(middle >> 64) +
+               (uint64_t)(other_middle >> 64);
+  __uint128_t qp = (__uint128_t)q * p;
+  uint64_t r = x_lo - (uint64_t)qp;
+  return x < qp ? r + p : r;
+}
+
 #elif defined(_MSC_VER) && defined(_M_AMD64) && (_MSC_VER >= 1923)
 // Visual Studio lacks support for 128-bit integers
 // so they simulated are using multiword arithmatic
@@ -285,34 +807,608 @@ FASTMOD_API bool is_divisible_u64(uint64_t n, fastmod_u128_t M) {
   return !isgreater_u128(lowBits_hi, lowBits_low, Mdec_hi, Mdec_low);
 }
 
+// M = floor( (1<<128) / d ) + 1
+// you must have that d is different from 0 and -9223372036854775808
+FASTMOD_API fastmod_u128_t computeM_s64(int64_t d) {
+  if (d < 0)
+    d = -d;
+  fastmod_u128_t M = computeM_u64(d);
+  if ((d & (d - 1)) == 0)
+    M.low = add128_u64(M.hi, M.low, 1, &M.hi);
+  return M;
+}
+
+// computes (a % d) given precomputed M,
+// you should pass the absolute value of d
+FASTMOD_API int64_t fastmod_s64(int64_t a, fastmod_u128_t M, int64_t positive_d) {
+  uint64_t lowbits_hi;
+  uint64_t lowbits_lo = mul128_u64_lo(M.hi, M.low, a, &lowbits_hi);
+  // a is sign extended to 128 bits
+  if (a < 0)
+    lowbits_hi -= M.low;
+
+  int64_t highbits = (int64_t)mul128_u64_hi(lowbits_hi, lowbits_lo, positive_d);
+  return highbits - ((positive_d - 1) & (a >> 63));
+}
+
+// Returns the highest 64 bits of M * a for a signed a
+FASTMOD_API uint64_t mul128_s64(fastmod_u128_t M, int64_t a) {
+  // floor(M.low * a / 2^64), between -2^64 and 2^64
+  uint64_t bottomHalf_lo;
+  bool borrow = _subborrow_u64(0, __umulh(M.low, a), a < 0 ? M.low : 0, &bottomHalf_lo);
+  uint64_t bottomHalf_hi = borrow ? ~UINT64_C(0) : 0;
+
+  // M.hi * a as a signed 128-bit value
+  uint64_t topHalf_hi;
+  uint64_t topHalf_lo = _umul128(M.hi, a, &topHalf_hi);
+  if (a < 0)
+    topHalf_hi -= M.hi;
+
+  uint64_t bothHalves_lo;
+  bool carry = _addcarry_u64(0, topHalf_lo, bottomHalf_lo, &bothHalves_lo);
+  uint64_t bothHalves_hi;
+  _addcarry_u64(carry, topHalf_hi, bottomHalf_hi, &bothHalves_hi);
+
+  return bothHalves_hi;
+}
+
+// mulmod computes (a * b) % p given precomputed M = computeM_u64(p) for
+// p>1, you must have that a < p
+FASTMOD_API uint64_t mulmod_u64(uint64_t a, uint64_t b, fastmod_u128_t M,
+                                uint64_t p) {
+  uint64_t x_hi;
+  uint64_t x_lo = _umul128(a, b, &x_hi);
+  // q = floor(x * M / 2^128) is floor(x / p) or one more, since x < p 2^64
+  uint64_t middle_hi;
+  uint64_t middle_lo = _umul128(x_hi, M.low, &middle_hi);
+  middle_lo = add128_u64(middle_hi, middle_lo, __umulh(x_lo, M.low), &middle_hi);
+  uint64_t other_hi;
+  uint64_t other_lo = _umul128(x_lo, M.hi, &other_hi);
+  add128_u64(other_hi, other_lo, middle_lo, &other_hi);
+  uint64_t q = x_hi * M.hi + middle_hi + other_hi;
+
+  uint64_t qp_hi;
+  uint64_t qp_lo = _umul128(q, p, &qp_hi);
+  uint64_t r = x_lo - qp_lo;
+  return isgreater_u128(qp_hi, qp_lo, x_hi, x_lo) ? r + p : r;
+}
 
-// End of the 64-bit functions
 
 #endif // #ifndef _MSC_VER
 
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+
+/**
+ * signed 64-bit integers
+ * Usage:
+ *  int64_t d = ... ; // should be non-zero and not -9223372036854775808
+ *  int64_t positive_d = d < 0 ? -d : d; // absolute value
+ *  fastmod_u128_t M = computeM_s64(d); // do once
+ *  fastmod_s64(a,M,positive_d) is a % d for all 64-bit a.
+ *  fastdiv_s64(a,M,d) is a / d for all 64-bit a, d not one of -1, 1.
+ *  fastmod_floor_s64(a,M,d) and fastdiv_floor_s64(a,M,d) round the
+ *  quotient toward negative infinity (the remainder has the sign of d).
+ **/
+
+// fastdiv computes (a / d) given a precomputed M, assumes that d must not
+// be one of -1, 1, or -9223372036854775808
+FASTMOD_API int64_t fastdiv_s64(int64_t a, fastmod_u128_t M, int64_t d) {
+  uint64_t highbits = mul128_s64(M, a);
+  highbits += (a < 0 ? 1 : 0);
+  if (d < 0)
+    return -(int64_t)(highbits);
+  return (int64_t)(highbits);
+}
+
+// floor(a / d) given a precomputed M, same constraints as fastdiv_s64
+FASTMOD_API int64_t fastdiv_floor_s64(int64_t a, fastmod_u128_t M, int64_t d) {
+  int64_t q = fastdiv_s64(a, M, d);
+  int64_t r = (int64_t)((uint64_t)a - (uint64_t)q * (uint64_t)d);
+  return q - ((r != 0) && ((r ^ d) < 0) ? 1 : 0);
+}
+
+// a - floor(a / d) * d given a precomputed M, takes the signed d
+// if d = -1 and a = -9223372036854775808, the result is undefined
+FASTMOD_API int64_t fastmod_floor_s64(int64_t a, fastmod_u128_t M, int64_t d) {
+  int64_t r = fastmod_s64(a, M, d < 0 ? -d : d);
+  return r + ((r != 0) && ((r ^ d) < 0) ? d : 0);
+}
+
+// fastdivmod computes (a / d) and stores (a % d) in *remainder given
+// precomputed M for d>1, the remainder is recovered as a - q * d
+FASTMOD_API uint64_t fastdivmod_u64(uint64_t a, fastmod_u128_t M, uint64_t d,
+                                    uint64_t *remainder) {
+  uint64_t q = fastdiv_u64(a, M);
+  *remainder = a - q * d;
+  return q;
+}
+
+// fastdivmod computes (a / d) and stores (a % d) in *remainder given a
+// precomputed M, same constraints as fastdiv_s64
+FASTMOD_API int64_t fastdivmod_s64(int64_t a, fastmod_u128_t M, int64_t d,
+                                   int64_t *remainder) {
+  int64_t q = fastdiv_s64(a, M, d);
+  *remainder = (int64_t)((uint64_t)a - (uint64_t)q * (uint64_t)d);
+  return q;
+}
+
+/**
+ * Modular exponentiation and primality with 64-bit moduli.
+ * Usage:
+ *  uint64_t p = ... ; // modulus, should be greater than one
+ *  fastmod_u128_t M = computeM_u64(p); // do once
+ *  mulmod_u64(a,b,M,p) is (a * b) % p for all 64-bit b and a < p.
+ *  powmod_u64(a,e,M,p) is (a ^ e) % p for all 64-bit a and e.
+ *  is_prime_u64(n) tells you whether n is prime, no M needed.
+ **/
+
+// powmod computes (a ^ e) % p given precomputed M = computeM_u64(p) for p>1
+FASTMOD_API uint64_t powmod_u64(uint64_t a, uint64_t e, fastmod_u128_t M,
+                                uint64_t p) {
+  uint64_t result = 1;
+  a = fastmod_u64(a, M, p); // mulmod_u64 needs a < p
+  while (e != 0) {
+    if (e & 1)
+      result = mulmod_u64(a, result, M, p);
+    a = mulmod_u64(a, a, M, p);
+    e >>= 1;
+  }
+  return result;
+}
+
+// is_prime_u64 tells you whether n is prime, it runs a deterministic
+// Miller-Rabin test with the seven bases found by Jim Sinclair (enough for
+// all 64-bit n)
+FASTMOD_API bool is_prime_u64(uint64_t n) {
+  if (n <= UINT32_MAX)
+    return is_prime_u32((uint32_t)n);
+  if ((n & 1) == 0)
+    return false;
+  fastmod_u128_t M = computeM_u64(n);
+  // n - 1 = odd * 2^s
+  uint64_t odd = n - 1;
+  int s = 0;
+  while ((odd & 1) == 0) {
+    odd >>= 1;
+    s++;
+  }
+  const uint64_t bases[7] = {2,      325,     9375,      28178,
+                             450775, 9780504, 1795265022};
+  for (int i = 0; i < 7; i++) {
+    uint64_t x = powmod_u64(bases[i], odd, M, n);
+    if ((x == 1) || (x == n - 1))
+      continue;
+    int j = 1;
+    for (; j < s; j++) {
+      x = mulmod_u64(x, x, M, n);
+      if (x == n - 1)
+        break;
+    }
+    if (j == s)
+      return false;
+  }
+  return true;
+}
+
+#endif
+
+// End of the 64-bit functions
+
 #ifdef __cplusplus
 
-template <uint32_t d> FASTMOD_API uint32_t fastmod(uint32_t x) {
+/**
+ * Compile-time divisors, for uint32_t, int32_t, uint64_t and int64_t.
+ * Usage:
+ *  fastmod<d>(x) is x % d and fastdiv<d>(x) is x / d, d has the type of x
+ *  and should be non-zero (and not the smallest signed value)
+ *
+ * The magic number is computed at compile time. When d (or -d) is a power
+ * of two, including 1, no magic number is needed: the remainder is a mask
+ * and the quotient a shift, so fastmod<1> and fastdiv<1> reduce to nothing.
+ * An unsigned d larger than half the range of its type divides x at most
+ * once, so a comparison does. Under C++14, the functions are constexpr.
+ **/
+
+// how fastmod<d> and fastdiv<d> find the result, for an absolute value d
+enum fastmod_method { fastmod_magic, fastmod_shift, fastmod_compare };
+
+template <uint64_t d, uint64_t max> struct fastmod_method_of {
+  static const fastmod_method value =
+      (d != 0 && (d & (d - 1)) == 0)
+          ? fastmod_shift
+          : (d > max / 2 ? fastmod_compare : fastmod_magic);
+};
+
+// log2 of a power of two
+template <uint64_t d> struct fastmod_log2 {
+  static const int value = 1 + fastmod_log2<d / 2>::value;
+};
+template <> struct fastmod_log2<1> { static const int value = 0; };
+
+template <uint32_t d, fastmod_method m>
+using fastmod_u32_if = typename std::enable_if<
+    fastmod_method_of<d, UINT32_MAX>::value == m, uint32_t>::type;
+
+template <uint32_t d>
+FASTMOD_API fastmod_u32_if<d, fastmod_magic> fastmod(uint32_t x) {
   FASTMOD_CONSTEXPR uint64_t v = computeM_u32(d);
   return fastmod_u32(x, v, d);
 }
-template <uint32_t d> FASTMOD_API uint32_t fastdiv(uint32_t x) {
+template <uint32_t d>
+FASTMOD_API fastmod_u32_if<d, fastmod_magic> fastdiv(uint32_t x) {
   FASTMOD_CONSTEXPR uint64_t v = computeM_u32(d);
   return fastdiv_u32(x, v);
 }
-template <int32_t d> FASTMOD_API int32_t fastmod(int32_t x) {
+template <uint32_t d>
+FASTMOD_API fastmod_u32_if<d, fastmod_shift> fastmod(uint32_t x) {
+  return x & (d - 1);
+}
+template <uint32_t d>
+FASTMOD_API fastmod_u32_if<d, fastmod_shift> fastdiv(uint32_t x) {
+  return x >> fastmod_log2<d>::value;
+}
+template <uint32_t d>
+FASTMOD_API fastmod_u32_if<d, fastmod_compare> fastmod(uint32_t x) {
+  return x >= d ? x - d : x;
+}
+template <uint32_t d>
+FASTMOD_API fastmod_u32_if<d, fastmod_compare> fastdiv(uint32_t x) {
+  return x >= d ? 1 : 0;
+}
+
+// the signed functions only use the magic number and the shift
+template <int32_t d, bool shift>
+using fastmod_s32_if = typename std::enable_if<
+    (fastmod_method_of<d < 0 ? 0 - uint64_t(d) : uint64_t(d), UINT64_MAX>::
+         value == fastmod_shift) == shift,
+    int32_t>::type;
+
+template <int32_t d>
+FASTMOD_API fastmod_s32_if<d, false> fastmod(int32_t x) {
   FASTMOD_CONSTEXPR uint64_t v = computeM_s32(d);
-  return fastmod_s32(x, v, d);
+  return fastmod_s32(x, v, d < 0 ? -d : d);
 }
-template <int32_t d> FASTMOD_API int32_t fastdiv(int32_t x) {
+template <int32_t d>
+FASTMOD_API fastmod_s32_if<d, false> fastdiv(int32_t x) {
   FASTMOD_CONSTEXPR uint64_t v = computeM_s32(d);
   return fastdiv_s32(x, v, d);
 }
+// a negative x is biased by |d| - 1 so that the quotient rounds toward zero
+template <int32_t d>
+FASTMOD_API fastmod_s32_if<d, true> fastmod(int32_t x) {
+  const uint32_t mask = uint32_t(d < 0 ? -d : d) - 1;
+  const uint32_t bias = (uint32_t)(x >> 31) & mask;
+  return (int32_t)(((uint32_t)x + bias) & mask) - (int32_t)bias;
+}
+// if d = -1 and x = -2147483648, the result is undefined
+template <int32_t d>
+FASTMOD_API fastmod_s32_if<d, true> fastdiv(int32_t x) {
+  const uint32_t bias = (uint32_t)(x >> 31) & (uint32_t(d < 0 ? -d : d) - 1);
+  const int32_t q = (int32_t)((uint32_t)x + bias) >>
+                    fastmod_log2<uint32_t(d < 0 ? -d : d)>::value;
+  return d < 0 ? -q : q;
+}
+
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+template <uint64_t d, fastmod_method m>
+using fastmod_u64_if = typename std::enable_if<
+    fastmod_method_of<d, UINT64_MAX>::value == m, uint64_t>::type;
+
+template <uint64_t d>
+FASTMOD_API fastmod_u64_if<d, fastmod_magic> fastmod(uint64_t x) {
+  FASTMOD_CONSTEXPR fastmod_u128_t v = computeM_u64(d);
+  return fastmod_u64(x, v, d);
+}
+template <uint64_t d>
+FASTMOD_API fastmod_u64_if<d, fastmod_magic> fastdiv(uint64_t x) {
+  FASTMOD_CONSTEXPR fastmod_u128_t v = computeM_u64(d);
+  return fastdiv_u64(x, v);
+}
+template <uint64_t d>
+FASTMOD_API fastmod_u64_if<d, fastmod_shift> fastmod(uint64_t x) {
+  return x & (d - 1);
+}
+template <uint64_t d>
+FASTMOD_API fastmod_u64_if<d, fastmod_shift> fastdiv(uint64_t x) {
+  return x >> fastmod_log2<d>::value;
+}
+template <uint64_t d>
+FASTMOD_API fastmod_u64_if<d, fastmod_compare> fastmod(uint64_t x) {
+  return x >= d ? x - d : x;
+}
+template <uint64_t d>
+FASTMOD_API fastmod_u64_if<d, fastmod_compare> fastdiv(uint64_t x) {
+  return x >= d ? 1 : 0;
+}
+
+template <int64_t d, bool shift>
+using fastmod_s64_if = typename std::enable_if<
+    (fastmod_method_of<d < 0 ? 0 - uint64_t(d) : uint64_t(d), UINT64_MAX>::
+         value == fastmod_shift) == shift,
+    int64_t>::type;
+
+template <int64_t d>
+FASTMOD_API fastmod_s64_if<d, false> fastmod(int64_t x) {
+  FASTMOD_CONSTEXPR fastmod_u128_t v = computeM_s64(d);
+  return fastmod_s64(x, v, d < 0 ? -d : d);
+}
+template <int64_t d>
+FASTMOD_API fastmod_s64_if<d, false> fastdiv(int64_t x) {
+  FASTMOD_CONSTEXPR fastmod_u128_t v = computeM_s64(d);
+  return fastdiv_s64(x, v, d);
+}
+template <int64_t d>
+FASTMOD_API fastmod_s64_if<d, true> fastmod(int64_t x) {
+  const uint64_t mask = uint64_t(d < 0 ? -d : d) - 1;
+  const uint64_t bias = (uint64_t)(x >> 63) & mask;
+  return (int64_t)(((uint64_t)x + bias) & mask) - (int64_t)bias;
+}
+// if d = -1 and x = -9223372036854775808, the result is undefined
+template <int64_t d>
+FASTMOD_API fastmod_s64_if<d, true> fastdiv(int64_t x) {
+  const uint64_t bias = (uint64_t)(x >> 63) & (uint64_t(d < 0 ? -d : d) - 1);
+  const int64_t q = (int64_t)((uint64_t)x + bias) >>
+                    fastmod_log2<uint64_t(d < 0 ? -d : d)>::value;
+  return d < 0 ? -q : q;
+}
+#endif
+
+/**
+ * Runtime divisors, for uint32_t, int32_t, uint64_t and int64_t.
+ * Usage:
+ *  fastmod::divisor<uint32_t> div(d); // do once, d should be non-zero
+ *  x % div is x % d, x / div is x / d
+ *  div.divmod(x) returns both the quotient and the remainder
+ *  div.divides(x) checks whether x % d == 0
+ *
+ * The magic number and the divisor (and, for signed types, its absolute
+ * value) are kept together so that they cannot be mixed up. Unlike
+ * fastdiv_u32 and fastdiv_s32, the divisors 1 and -1 are supported.
+ **/
+
+template <typename T> struct divmod_result {
+  T quotient;
+  T remainder;
+};
+
+template <typename T> class divisor;
+
+template <> class divisor<uint32_t> {
+public:
+  typedef uint32_t value_type;
+
+  FASTMOD_CONSTEXPR explicit divisor(uint32_t v) : M(computeM_u32(v)), d(v) {}
+
+  FASTMOD_CONSTEXPR uint32_t value() const { return d; }
+  FASTMOD_CONSTEXPR uint64_t magic() const { return M; }
+
+  FASTMOD_CONSTEXPR uint32_t mod(uint32_t x) const {
+    return fastmod_u32(x, M, d);
+  }
+  FASTMOD_CONSTEXPR uint32_t div(uint32_t x) const {
+    return d == 1 ? x : fastdiv_u32(x, M);
+  }
+  FASTMOD_CONSTEXPR divmod_result<uint32_t> divmod(uint32_t x) const {
+    if (d == 1)
+      return divmod_result<uint32_t>{x, 0};
+    uint32_t r = 0;
+    uint32_t q = fastdivmod_u32(x, M, d, &r);
+    return divmod_result<uint32_t>{q, r};
+  }
+  FASTMOD_CONSTEXPR bool divides(uint32_t x) const {
+    return is_divisible(x, M);
+  }
+
+private:
+  uint64_t M;
+  uint32_t d;
+};
+
+template <> class divisor<int32_t> {
+public:
+  typedef int32_t value_type;
+
+  // v must not be 0 or -2147483648
+  FASTMOD_CONSTEXPR explicit divisor(int32_t v)
+      : M(computeM_s32(v)), d(v), positive_d(v < 0 ? -v : v) {}
+
+  FASTMOD_CONSTEXPR int32_t value() const { return d; }
+  FASTMOD_CONSTEXPR uint64_t magic() const { return M; }
+
+  // if d = -1 and x = -2147483648, the result is undefined
+  FASTMOD_CONSTEXPR int32_t mod(int32_t x) const {
+    return fastmod_s32(x, M, positive_d);
+  }
+  // if d = -1 and x = -2147483648, the result is undefined
+  FASTMOD_CONSTEXPR int32_t div(int32_t x) const {
+    return positive_d == 1 ? (d < 0 ? -x : x) : fastdiv_s32(x, M, d);
+  }
+  FASTMOD_CONSTEXPR divmod_result<int32_t> divmod(int32_t x) const {
+    if (positive_d == 1)
+      return divmod_result<int32_t>{d < 0 ? -x : x, 0};
+    int32_t r = 0;
+    int32_t q = fastdivmod_s32(x, M, d, &r);
+    return divmod_result<int32_t>{q, r};
+  }
+  FASTMOD_CONSTEXPR bool divides(int32_t x) const { return mod(x) == 0; }
+
+private:
+  uint64_t M;
+  int32_t d;
+  int32_t positive_d;
+};
+
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+
+template <> class divisor<uint64_t> {
+public:
+  typedef uint64_t value_type;
+
+  FASTMOD_CONSTEXPR explicit divisor(uint64_t v) : M(computeM_u64(v)), d(v) {}
+
+  FASTMOD_CONSTEXPR uint64_t value() const { return d; }
+  FASTMOD_CONSTEXPR fastmod_u128_t magic() const { return M; }
+
+  FASTMOD_CONSTEXPR uint64_t mod(uint64_t x) const {
+    return fastmod_u64(x, M, d);
+  }
+  FASTMOD_CONSTEXPR uint64_t div(uint64_t x) const {
+    return d == 1 ? x : fastdiv_u64(x, M);
+  }
+  FASTMOD_CONSTEXPR divmod_result<uint64_t> divmod(uint64_t x) const {
+    if (d == 1)
+      return divmod_result<uint64_t>{x, 0};
+    uint64_t r = 0;
+    uint64_t q = fastdivmod_u64(x, M, d, &r);
+    return divmod_result<uint64_t>{q, r};
+  }
+  FASTMOD_CONSTEXPR bool divides(uint64_t x) const {
+    return is_divisible_u64(x, M);
+  }
+
+private:
+  fastmod_u128_t M;
+  uint64_t d;
+};
+
+template <> class divisor<int64_t> {
+public:
+  typedef int64_t value_type;
+
+  // v must not be 0 or -9223372036854775808
+  FASTMOD_CONSTEXPR explicit divisor(int64_t v)
+      : M(computeM_s64(v)), d(v), positive_d(v < 0 ? -v : v) {}
+
+  FASTMOD_CONSTEXPR int64_t value() const { return d; }
+  FASTMOD_CONSTEXPR fastmod_u128_t magic() const { return M; }
+
+  // if d = -1 and x = -9223372036854775808, the result is undefined
+  FASTMOD_CONSTEXPR int64_t mod(int64_t x) const {
+    return fastmod_s64(x, M, positive_d);
+  }
+  // if d = -1 and x = -9223372036854775808, the result is undefined
+  FASTMOD_CONSTEXPR int64_t div(int64_t x) const {
+    return positive_d == 1 ? (d < 0 ? -x : x) : fastdiv_s64(x, M, d);
+  }
+  FASTMOD_CONSTEXPR divmod_result<int64_t> divmod(int64_t x) const {
+    if (positive_d == 1)
+      return divmod_result<int64_t>{d < 0 ? -x : x, 0};
+    int64_t r = 0;
+    int64_t q = fastdivmod_s64(x, M, d, &r);
+    return divmod_result<int64_t>{q, r};
+  }
+  FASTMOD_CONSTEXPR bool divides(int64_t x) const { return mod(x) == 0; }
+
+private:
+  fastmod_u128_t M;
+  int64_t d;
+  int64_t positive_d;
+};
+
+#endif
+
+// The dividend is converted to the type of the divisor.
+template <typename T>
+FASTMOD_CONSTEXPR T operator%(typename divisor<T>::value_type x,
+                              const divisor<T> &div) {
+  return div.mod(x);
+}
+template <typename T>
+FASTMOD_CONSTEXPR T operator/(typename divisor<T>::value_type x,
+                              const divisor<T> &div) {
+  return div.div(x);
+}
+template <typename T> T &operator%=(T &x, const divisor<T> &div) {
+  return x = div.mod(x);
+}
+template <typename T> T &operator/=(T &x, const divisor<T> &div) {
+  return x = div.div(x);
+}
+
+/**
+ * Mixed-radix decoding, for uint32_t and uint64_t indices.
+ * Usage:
+ *  const uint32_t shape[3] = {h, w, c}; // extents, should be non-zero
+ *  fastmod::mixed_radix<3> radix(shape); // do once
+ *  uint32_t coords[3];
+ *  radix.decode(index, coords); // index is (coords[0] * w + coords[1]) * c
+ *                               // + coords[2]
+ *  radix.decode_batch(indices, out, n); // out[3 * i + k] for indices[i]
+ *  radix.encode(coords) // is index
+ *
+ * The last coordinate varies fastest. Each step is a fused divmod by a
+ * precomputed magic number. The first coordinate is what is left of the
+ * index and it is not reduced by shape[0]: with the extents {1, 24, 60, 60},
+ * a number of seconds decodes to days, hours, minutes and seconds.
+ * Use fastmod::mixed_radix<N, uint64_t> for 64-bit indices.
+ **/
+
+template <size_t N, typename T = uint32_t> class mixed_radix {
+  static_assert(N > 0, "there must be at least one extent");
+
+public:
+  typedef T value_type;
+  typedef decltype(divisor<T>(T(1)).magic()) magic_type;
+
+  explicit mixed_radix(const T (&extents)[N]) {
+    for (size_t k = 0; k < N; k++) {
+      d[k] = extents[k];
+      M[k] = divisor<T>(extents[k]).magic();
+    }
+  }
+
+  T extent(size_t k) const { return d[k]; }
+
+  void decode(T index, T *coords) const {
+    for (size_t k = N - 1; k > 0; k--) {
+      index = divmod(index, M[k], d[k], &coords[k]);
+    }
+    coords[0] = index;
+  }
+
+  // out[N * i + k] is the coordinate k of indices[i]
+  void decode_batch(const T *indices, T *out, size_t n) const {
+    for (size_t i = 0; i < n; i++) {
+      decode(indices[i], out + N * i);
+    }
+  }
+
+  T encode(const T *coords) const {
+    T index = coords[0];
+    for (size_t k = 1; k < N; k++) {
+      index = index * d[k] + coords[k];
+    }
+    return index;
+  }
+
+private:
+  static uint32_t divmod(uint32_t x, uint64_t m, uint32_t v, uint32_t *r) {
+    if (v == 1) {
+      *r = 0;
+      return x;
+    }
+    return fastdivmod_u32(x, m, v, r);
+  }
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+  static uint64_t divmod(uint64_t x, fastmod_u128_t m, uint64_t v,
+                         uint64_t *r) {
+    if (v == 1) {
+      *r = 0;
+      return x;
+    }
+    return fastdivmod_u64(x, m, v, r);
+  }
+#endif
+
+  magic_type M[N];
+  T d[N];
+};
 
 } // fastmod
 #endif
 
 #undef FASTMOD_API
 #undef FASTMOD_CONSTEXPR
+#undef FASTMOD_TABLE
 
 #endif // FASTMOD_H
@@ -0,0 +1,1274 @@
+#ifndef FASTMOD_BATCH_H
+#define FASTMOD_BATCH_H
+
+#include "fastmod.h"
+
+#ifndef __cplusplus
+#include <stddef.h>
+#else
+#include <cstddef>
+#endif
+
+// The vector kernels are compiled when the target supports them (e.g.,
+// -mavx2) and also when they can be compiled for a processor that is only
+// known at runtime: GCC and clang accept target attributes and Visual Studio
+// always accepts the intrinsics. The fastmod_u32_batch functions only use
+// the kernels enabled at compile time, fastmod_dispatch.h picks one at
+// runtime.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FASTMOD_RUNTIME_KERNELS
+#define FASTMOD_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define FASTMOD_TARGET_AVX2 __attribute__((target("avx2")))
+#define FASTMOD_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#if defined(_MSC_VER) && defined(_M_AMD64)
+#define FASTMOD_RUNTIME_KERNELS
+#endif
+#define FASTMOD_TARGET_SSE41
+#define FASTMOD_TARGET_AVX2
+#define FASTMOD_TARGET_AVX512
+#endif
+
+#if defined(__SSE4_1__) || defined(FASTMOD_RUNTIME_KERNELS)
+#define FASTMOD_BATCH_SSE41
+#endif
+#if defined(__AVX2__) || defined(FASTMOD_RUNTIME_KERNELS)
+#define FASTMOD_BATCH_AVX2
+#endif
+#if defined(__AVX512F__) || defined(FASTMOD_RUNTIME_KERNELS)
+#define FASTMOD_BATCH_AVX512
+#endif
+
+// Away from x64, GCC and clang vectorize the portable kernels. Define
+// FASTMOD_BATCH_PORTABLE to use them on x64 too, where the SSE4.1, AVX2 and
+// AVX-512 kernels still take precedence when the compiler targets them.
+#if !defined(FASTMOD_BATCH_PORTABLE) &&                                       \
+    (defined(__GNUC__) || defined(__clang__)) && !defined(__x86_64__) &&      \
+    !defined(__i386__)
+#define FASTMOD_BATCH_PORTABLE
+#endif
+
+// GCC warns that the undefined vectors in its AVX-512 intrinsics may be
+// used uninitialized.
+#if defined(FASTMOD_BATCH_AVX512) && defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#define FASTMOD_BATCH_POP_DIAGNOSTIC
+#endif
+
+#if defined(FASTMOD_BATCH_SSE41) || defined(FASTMOD_BATCH_AVX2) ||             \
+    defined(FASTMOD_BATCH_AVX512)
+#include <immintrin.h>
+#endif
+
+#ifndef __cplusplus
+#define FASTMOD_BATCH_API static inline
+#else
+#define FASTMOD_BATCH_API inline
+#endif
+
+#ifdef __cplusplus
+namespace fastmod {
+#endif
+
+/**
+ * Array versions of the 32-bit functions.
+ * Usage:
+ *  uint32_t d = ... ; // divisor, should be non-zero
+ *  uint64_t M = computeM_u32(d); // do once
+ *  fastmod_u32_batch(in, out, n, M, d); // out[i] = in[i] % d for i < n
+ *  fastdiv_u32_batch(in, out, n, M); // out[i] = in[i] / d for i < n, d > 1
+ *
+ * The input and output arrays may be the same but should not otherwise
+ * overlap. When the code is compiled with AVX2 or AVX-512 support
+ * (e.g., -mavx2 or -march=native), the products are computed
+ * with vpmuludq (32-bit x 32-bit -> 64-bit) on several values at once.
+ **/
+
+FASTMOD_BATCH_API void fastmod_u32_batch_scalar(const uint32_t *in,
+                                                uint32_t *out, size_t n,
+                                                uint64_t M, uint32_t d) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = fastmod_u32(in[i], M, d);
+  }
+}
+
+FASTMOD_BATCH_API void fastdiv_u32_batch_scalar(const uint32_t *in,
+                                                uint32_t *out, size_t n,
+                                                uint64_t M) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = fastdiv_u32(in[i], M);
+  }
+}
+
+#ifdef FASTMOD_BATCH_SSE41
+
+// Same as fastmod_u32_avx2_lanes, with two 64-bit lanes.
+FASTMOD_TARGET_SSE41
+static inline __m128i fastmod_u32_sse41_lanes(__m128i a, __m128i Mlo,
+                                              __m128i Mhi, __m128i d) {
+  __m128i lowbits = _mm_add_epi64(_mm_mul_epu32(Mlo, a),
+                                  _mm_slli_epi64(_mm_mul_epu32(Mhi, a), 32));
+  __m128i bottom = _mm_srli_epi64(_mm_mul_epu32(lowbits, d), 32);
+  return _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(lowbits, 32), d), bottom);
+}
+
+// Same as fastdiv_u32_avx2_lanes, with two 64-bit lanes.
+FASTMOD_TARGET_SSE41
+static inline __m128i fastdiv_u32_sse41_lanes(__m128i a, __m128i Mlo,
+                                              __m128i Mhi) {
+  __m128i bottom = _mm_srli_epi64(_mm_mul_epu32(Mlo, a), 32);
+  return _mm_add_epi64(_mm_mul_epu32(Mhi, a), bottom);
+}
+
+FASTMOD_TARGET_SSE41
+FASTMOD_BATCH_API void fastmod_u32_batch_sse41(const uint32_t *in,
+                                               uint32_t *out, size_t n,
+                                               uint64_t M, uint32_t d) {
+  const __m128i Mlo = _mm_set1_epi64x((long long)(M & 0xFFFFFFFF));
+  const __m128i Mhi = _mm_set1_epi64x((long long)(M >> 32));
+  const __m128i vd = _mm_set1_epi64x((long long)d);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(in + i));
+    __m128i even = fastmod_u32_sse41_lanes(a, Mlo, Mhi, vd);
+    __m128i odd = fastmod_u32_sse41_lanes(_mm_srli_epi64(a, 32), Mlo, Mhi, vd);
+    __m128i result = _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xCC);
+    _mm_storeu_si128((__m128i *)(out + i), result);
+  }
+  fastmod_u32_batch_scalar(in + i, out + i, n - i, M, d);
+}
+
+FASTMOD_TARGET_SSE41
+FASTMOD_BATCH_API void fastdiv_u32_batch_sse41(const uint32_t *in,
+                                               uint32_t *out, size_t n,
+                                               uint64_t M) {
+  const __m128i Mlo = _mm_set1_epi64x((long long)(M & 0xFFFFFFFF));
+  const __m128i Mhi = _mm_set1_epi64x((long long)(M >> 32));
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(in + i));
+    __m128i even = fastdiv_u32_sse41_lanes(a, Mlo, Mhi);
+    __m128i odd = fastdiv_u32_sse41_lanes(_mm_srli_epi64(a, 32), Mlo, Mhi);
+    __m128i result = _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xCC);
+    _mm_storeu_si128((__m128i *)(out + i), result);
+  }
+  fastdiv_u32_batch_scalar(in + i, out + i, n - i, M);
+}
+
+#endif // FASTMOD_BATCH_SSE41
+
+#ifdef FASTMOD_BATCH_AVX2
+
+// Each 64-bit lane holds a 32-bit dividend a in its low half. Returns, in
+// the high half of each lane, the value of ((M * a mod 2^64) * d) >> 64.
+FASTMOD_TARGET_AVX2
+static inline __m256i fastmod_u32_avx2_lanes(__m256i a, __m256i Mlo,
+                                             __m256i Mhi, __m256i d) {
+  // lowbits = M * a (mod 2^64)
+  __m256i lowbits = _mm256_add_epi64(
+      _mm256_mul_epu32(Mlo, a),
+      _mm256_slli_epi64(_mm256_mul_epu32(Mhi, a), 32));
+  // (lowbits * d) >> 32, the result lands in the high 32 bits
+  __m256i bottom =
+      _mm256_srli_epi64(_mm256_mul_epu32(lowbits, d), 32);
+  return _mm256_add_epi64(
+      _mm256_mul_epu32(_mm256_srli_epi64(lowbits, 32), d), bottom);
+}
+
+// Each 64-bit lane holds a 32-bit dividend a in its low half. Returns, in
+// the high half of each lane, the value of (M * a) >> 64.
+FASTMOD_TARGET_AVX2
+static inline __m256i fastdiv_u32_avx2_lanes(__m256i a, __m256i Mlo,
+                                             __m256i Mhi) {
+  __m256i bottom = _mm256_srli_epi64(_mm256_mul_epu32(Mlo, a), 32);
+  return _mm256_add_epi64(_mm256_mul_epu32(Mhi, a), bottom);
+}
+
+FASTMOD_TARGET_AVX2
+FASTMOD_BATCH_API void fastmod_u32_batch_avx2(const uint32_t *in,
+                                              uint32_t *out, size_t n,
+                                              uint64_t M, uint32_t d) {
+  const __m256i Mlo = _mm256_set1_epi64x((long long)(M & 0xFFFFFFFF));
+  const __m256i Mhi = _mm256_set1_epi64x((long long)(M >> 32));
+  const __m256i vd = _mm256_set1_epi64x((long long)d);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(in + i));
+    __m256i even = fastmod_u32_avx2_lanes(a, Mlo, Mhi, vd);
+    __m256i odd =
+        fastmod_u32_avx2_lanes(_mm256_srli_epi64(a, 32), Mlo, Mhi, vd);
+    __m256i result =
+        _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+    _mm256_storeu_si256((__m256i *)(out + i), result);
+  }
+  fastmod_u32_batch_scalar(in + i, out + i, n - i, M, d);
+}
+
+FASTMOD_TARGET_AVX2
+FASTMOD_BATCH_API void fastdiv_u32_batch_avx2(const uint32_t *in,
+                                              uint32_t *out, size_t n,
+                                              uint64_t M) {
+  const __m256i Mlo = _mm256_set1_epi64x((long long)(M & 0xFFFFFFFF));
+  const __m256i Mhi = _mm256_set1_epi64x((long long)(M >> 32));
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(in + i));
+    __m256i even = fastdiv_u32_avx2_lanes(a, Mlo, Mhi);
+    __m256i odd = fastdiv_u32_avx2_lanes(_mm256_srli_epi64(a, 32), Mlo, Mhi);
+    __m256i result =
+        _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+    _mm256_storeu_si256((__m256i *)(out + i), result);
+  }
+  fastdiv_u32_batch_scalar(in + i, out + i, n - i, M);
+}
+
+#endif // FASTMOD_BATCH_AVX2
+
+#ifdef FASTMOD_BATCH_AVX512
+
+// Same as fastmod_u32_avx2_lanes, with eight 64-bit lanes.
+FASTMOD_TARGET_AVX512
+static inline __m512i fastmod_u32_avx512_lanes(__m512i a, __m512i Mlo,
+                                               __m512i Mhi, __m512i d) {
+  __m512i lowbits = _mm512_add_epi64(
+      _mm512_mul_epu32(Mlo, a),
+      _mm512_slli_epi64(_mm512_mul_epu32(Mhi, a), 32));
+  __m512i bottom =
+      _mm512_srli_epi64(_mm512_mul_epu32(lowbits, d), 32);
+  return _mm512_add_epi64(
+      _mm512_mul_epu32(_mm512_srli_epi64(lowbits, 32), d), bottom);
+}
+
+// Same as fastdiv_u32_avx2_lanes, with eight 64-bit lanes.
+FASTMOD_TARGET_AVX512
+static inline __m512i fastdiv_u32_avx512_lanes(__m512i a, __m512i Mlo,
+                                               __m512i Mhi) {
+  __m512i bottom = _mm512_srli_epi64(_mm512_mul_epu32(Mlo, a), 32);
+  return _mm512_add_epi64(_mm512_mul_epu32(Mhi, a), bottom);
+}
+
+FASTMOD_TARGET_AVX512
+FASTMOD_BATCH_API void fastmod_u32_batch_avx512(const uint32_t *in,
+                                                uint32_t *out, size_t n,
+                                                uint64_t M, uint32_t d) {
+  const __m512i Mlo = _mm512_set1_epi64((long long)(M & 0xFFFFFFFF));
+  const __m512i Mhi = _mm512_set1_epi64((long long)(M >> 32));
+  const __m512i vd = _mm512_set1_epi64((long long)d);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512i a = _mm512_loadu_si512((const void *)(in + i));
+    __m512i even = fastmod_u32_avx512_lanes(a, Mlo, Mhi, vd);
+    __m512i odd =
+        fastmod_u32_avx512_lanes(_mm512_srli_epi64(a, 32), Mlo, Mhi, vd);
+    __m512i result = _mm512_mask_blend_epi32(
+        0xAAAA, _mm512_srli_epi64(even, 32), odd);
+    _mm512_storeu_si512((void *)(out + i), result);
+  }
+  fastmod_u32_batch_scalar(in + i, out + i, n - i, M, d);
+}
+
+FASTMOD_TARGET_AVX512
+FASTMOD_BATCH_API void fastdiv_u32_batch_avx512(const uint32_t *in,
+                                                uint32_t *out, size_t n,
+                                                uint64_t M) {
+  const __m512i Mlo = _mm512_set1_epi64((long long)(M & 0xFFFFFFFF));
+  const __m512i Mhi = _mm512_set1_epi64((long long)(M >> 32));
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512i a = _mm512_loadu_si512((const void *)(in + i));
+    __m512i even = fastdiv_u32_avx512_lanes(a, Mlo, Mhi);
+    __m512i odd =
+        fastdiv_u32_avx512_lanes(_mm512_srli_epi64(a, 32), Mlo, Mhi);
+    __m512i result = _mm512_mask_blend_epi32(
+        0xAAAA, _mm512_srli_epi64(even, 32), odd);
+    _mm512_storeu_si512((void *)(out + i), result);
+  }
+  fastdiv_u32_batch_scalar(in + i, out + i, n - i, M);
+}
+
+#endif // FASTMOD_BATCH_AVX512
+
+// Portable kernels: the high multiplications are split so that every
+// product has 32-bit factors and the loops have no 128-bit arithmetic.
+// GCC and clang then vectorize them with widening multiplications on any
+// target (vpmuludq on x86, umull on ARM) without intrinsics. On x64, the
+// SSE4.1, AVX2 and AVX-512 kernels above are faster.
+
+FASTMOD_BATCH_API void fastdiv_u32_batch_portable(const uint32_t *in,
+                                                  uint32_t *out, size_t n,
+                                                  uint64_t M) {
+  const uint32_t Mlo = (uint32_t)M;
+  const uint32_t Mhi = (uint32_t)(M >> 32);
+  for (size_t i = 0; i < n; i++) {
+    uint32_t a = in[i];
+    // (M * a) >> 64
+    out[i] = (uint32_t)(((uint64_t)Mhi * a + (((uint64_t)Mlo * a) >> 32)) >>
+                        32);
+  }
+}
+
+FASTMOD_BATCH_API void fastmod_u32_batch_portable(const uint32_t *in,
+                                                  uint32_t *out, size_t n,
+                                                  uint64_t M, uint32_t d) {
+  if (d == 1) {
+    fastmod_u32_batch_scalar(in, out, n, M, d); // the quotient needs d > 1
+    return;
+  }
+  const uint32_t Mlo = (uint32_t)M;
+  const uint32_t Mhi = (uint32_t)(M >> 32);
+  for (size_t i = 0; i < n; i++) {
+    uint32_t a = in[i];
+    uint32_t q =
+        (uint32_t)(((uint64_t)Mhi * a + (((uint64_t)Mlo * a) >> 32)) >> 32);
+    // a 32-bit multiplication, vectors have it on every target
+    out[i] = a - q * d;
+  }
+}
+
+// out[i] = in[i] % d given precomputed M, uses the widest kernel available
+FASTMOD_BATCH_API void fastmod_u32_batch(const uint32_t *in, uint32_t *out,
+                                         size_t n, uint64_t M, uint32_t d) {
+#if defined(__AVX512F__)
+  fastmod_u32_batch_avx512(in, out, n, M, d);
+#elif defined(__AVX2__)
+  fastmod_u32_batch_avx2(in, out, n, M, d);
+#elif defined(__SSE4_1__)
+  fastmod_u32_batch_sse41(in, out, n, M, d);
+#elif defined(FASTMOD_BATCH_PORTABLE)
+  fastmod_u32_batch_portable(in, out, n, M, d);
+#else
+  fastmod_u32_batch_scalar(in, out, n, M, d);
+#endif
+}
+
+// out[i] = in[i] / d given precomputed M for d>1, uses the widest kernel
+// available
+FASTMOD_BATCH_API void fastdiv_u32_batch(const uint32_t *in, uint32_t *out,
+                                         size_t n, uint64_t M) {
+#if defined(__AVX512F__)
+  fastdiv_u32_batch_avx512(in, out, n, M);
+#elif defined(__AVX2__)
+  fastdiv_u32_batch_avx2(in, out, n, M);
+#elif defined(__SSE4_1__)
+  fastdiv_u32_batch_sse41(in, out, n, M);
+#elif defined(FASTMOD_BATCH_PORTABLE)
+  fastdiv_u32_batch_portable(in, out, n, M);
+#else
+  fastdiv_u32_batch_scalar(in, out, n, M);
+#endif
+}
+
+/**
+ * Magic numbers of many divisors.
+ * Usage:
+ *  computeM_u32_batch(d, M, n); // M[i] = computeM_u32(d[i]) for i < n
+ *
+ * The divisors should be non-zero. The magic numbers come from the same
+ * steps as computeM_u32_nodiv, which needs no division instruction, so that
+ * with AVX2 (e.g., -mavx2) four divisors go through each step at once: their
+ * exponent as a double gives the normalizing shift and a few Newton steps
+ * in double precision give the reciprocal. When the hardware divides 64-bit
+ * integers quickly, a loop over computeM_u32 may still be faster; see
+ * tests/setupbenchmark.cpp.
+ **/
+
+FASTMOD_BATCH_API void computeM_u32_batch_scalar(const uint32_t *d,
+                                                 uint64_t *M, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    M[i] = computeM_u32_nodiv(d[i]);
+  }
+}
+
+#ifdef FASTMOD_BATCH_AVX2
+
+// Same as fastmod_div_2by1_u32 on the 32-bit values in the low half of each
+// 64-bit lane.
+FASTMOD_TARGET_AVX2
+static inline __m256i fastmod_div_2by1_avx2_lanes(__m256i u1, __m256i u0,
+                                                  __m256i dn, __m256i v,
+                                                  __m256i *remainder) {
+  const __m256i low32 = _mm256_set1_epi64x(0xFFFFFFFF);
+  const __m256i p = _mm256_add_epi64(_mm256_mul_epu32(v, u1),
+                                     _mm256_or_si256(_mm256_slli_epi64(u1, 32),
+                                                     u0));
+  const __m256i p0 = _mm256_and_si256(p, low32);
+  __m256i q = _mm256_and_si256(
+      _mm256_add_epi64(_mm256_srli_epi64(p, 32), _mm256_set1_epi64x(1)),
+      low32);
+  __m256i r = _mm256_and_si256(_mm256_sub_epi64(u0, _mm256_mul_epu32(q, dn)),
+                               low32);
+  // the lanes hold 32-bit values, the signed comparisons are exact
+  __m256i m = _mm256_cmpgt_epi64(r, p0); // q--, r += dn
+  q = _mm256_and_si256(_mm256_add_epi64(q, m), low32);
+  r = _mm256_and_si256(_mm256_add_epi64(r, _mm256_and_si256(m, dn)), low32);
+  m = _mm256_cmpgt_epi64(r, _mm256_sub_epi64(dn, _mm256_set1_epi64x(1)));
+  q = _mm256_sub_epi64(q, m); // q++, r -= dn
+  *remainder = _mm256_sub_epi64(r, _mm256_and_si256(m, dn));
+  return q;
+}
+
+// Same as computeM_u32_nodiv on the four divisors, zero-extended to 64 bits.
+FASTMOD_TARGET_AVX2
+static inline __m256i computeM_u32_avx2_lanes(__m256i d) {
+  const __m256i low32 = _mm256_set1_epi64x(0xFFFFFFFF);
+  // 2^52 + d as a double, minus 2^52, is d exactly: its exponent field is
+  // 1023 + floor(log2(d)) and the shift is s = 31 - floor(log2(d))
+  const __m256d two52 = _mm256_set1_pd(4503599627370496.0);
+  const __m256d f = _mm256_sub_pd(
+      _mm256_castsi256_pd(_mm256_or_si256(d, _mm256_castpd_si256(two52))),
+      two52);
+  const __m256i s = _mm256_sub_epi64(
+      _mm256_set1_epi64x(1023 + 31),
+      _mm256_srli_epi64(_mm256_castpd_si256(f), 52));
+  const __m256i dn = _mm256_sllv_epi64(d, s);
+  // Newton in double precision from y0 = 48/17 - 32/17 a, a = dn / 2^32 in
+  // [1/2, 1), where y0 is within 1/17 of 1/a: four steps leave only the
+  // rounding errors, a gather from fastmod_reciprocal_table is slower
+  const __m256d a = _mm256_mul_pd(
+      _mm256_sub_pd(
+          _mm256_castsi256_pd(_mm256_or_si256(dn, _mm256_castpd_si256(two52))),
+          two52),
+      _mm256_set1_pd(1.0 / 4294967296.0));
+  const __m256d two = _mm256_set1_pd(2.0);
+  __m256d y = _mm256_sub_pd(_mm256_set1_pd(48.0 / 17.0),
+                            _mm256_mul_pd(_mm256_set1_pd(32.0 / 17.0), a));
+  for (int k = 0; k < 4; k++) {
+    y = _mm256_mul_pd(y, _mm256_sub_pd(two, _mm256_mul_pd(a, y)));
+  }
+  // the low bits of 2^52 - 2^32 - 1 + 2^32 y are 2^32 y - 2^32 - 1 rounded
+  // to an integer, which is v or v - 1
+  const __m256i low52 = _mm256_set1_epi64x((INT64_C(1) << 52) - 1);
+  __m256i v = _mm256_and_si256(
+      _mm256_castpd_si256(
+          _mm256_add_pd(_mm256_mul_pd(y, _mm256_set1_pd(4294967296.0)),
+                        _mm256_set1_pd(4503599627370496.0 - 4294967297.0))),
+      low52);
+  // r = 2^64 - 1 - (2^32 + v) dn < 2^33, v++ if r >= dn
+  const __m256i r = _mm256_xor_si256(
+      _mm256_add_epi64(_mm256_slli_epi64(dn, 32), _mm256_mul_epu32(dn, v)),
+      _mm256_set1_epi64x(-1));
+  v = _mm256_sub_epi64(
+      v, _mm256_cmpgt_epi64(r, _mm256_sub_epi64(dn, _mm256_set1_epi64x(1))));
+  // (2^64 - 1) 2^s / dn in two steps
+  __m256i rem;
+  const __m256i q1 = fastmod_div_2by1_avx2_lanes(
+      _mm256_sub_epi64(_mm256_sllv_epi64(_mm256_set1_epi64x(1), s),
+                       _mm256_set1_epi64x(1)),
+      low32, dn, v, &rem);
+  const __m256i q0 = fastmod_div_2by1_avx2_lanes(
+      rem, _mm256_and_si256(_mm256_sllv_epi64(low32, s), low32), dn, v, &rem);
+  return _mm256_add_epi64(_mm256_or_si256(_mm256_slli_epi64(q1, 32), q0),
+                          _mm256_set1_epi64x(1));
+}
+
+FASTMOD_TARGET_AVX2
+FASTMOD_BATCH_API void computeM_u32_batch_avx2(const uint32_t *d, uint64_t *M,
+                                               size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    // two independent chains of four divisors
+    __m256i lo =
+        _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(d + i)));
+    __m256i hi =
+        _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(d + i + 4)));
+    _mm256_storeu_si256((__m256i *)(M + i), computeM_u32_avx2_lanes(lo));
+    _mm256_storeu_si256((__m256i *)(M + i + 4), computeM_u32_avx2_lanes(hi));
+  }
+  computeM_u32_batch_scalar(d + i, M + i, n - i);
+}
+
+#endif // FASTMOD_BATCH_AVX2
+
+// M[i] = computeM_u32(d[i]) for non-zero divisors, uses AVX2 when available
+FASTMOD_BATCH_API void computeM_u32_batch(const uint32_t *d, uint64_t *M,
+                                          size_t n) {
+#if defined(__AVX2__)
+  computeM_u32_batch_avx2(d, M, n);
+#else
+  computeM_u32_batch_scalar(d, M, n);
+#endif
+}
+
+/**
+ * Divisibility bitmaps.
+ * Usage:
+ *  uint32_t d = ... ; // divisor, should be non-zero
+ *  uint64_t M = computeM_u32(d); // do once
+ *  uint64_t bits[(n + 63) / 64];
+ *  is_divisible_u32_batch(in, bits, n, M); // bit i is is_divisible(in[i],M)
+ *  mark_divisible_u32_range(start, bits, n, M); // sets bit j if d divides
+ *                                               // start + j, start + n <= 2^32
+ *
+ * Bit i lives in bits[i / 64] at position i % 64. The batch function
+ * overwrites the bitmap and clears the unused bits of the last word. The
+ * range function only sets bits, so that calling it with several divisors
+ * leaves the values divisible by any of them marked. This is how
+ * sieve_u32_segment works: it marks a segment with a list of divisors.
+ *
+ * Over a range, (start + j) * M mod 2^64 grows by M from one value to the
+ * next, so the vector kernels only need an addition and a comparison per
+ * value.
+ **/
+
+FASTMOD_BATCH_API void is_divisible_u32_batch_scalar(const uint32_t *in,
+                                                     uint64_t *bits, size_t n,
+                                                     uint64_t M) {
+  for (size_t i = 0; i < n; i += 64) {
+    size_t end = n - i < 64 ? n - i : 64;
+    uint64_t word = 0;
+    for (size_t j = 0; j < end; j++) {
+      word |= (uint64_t)is_divisible(in[i + j], M) << j;
+    }
+    bits[i / 64] = word;
+  }
+}
+
+FASTMOD_BATCH_API void mark_divisible_u32_range_scalar(uint32_t start,
+                                                       uint64_t *bits,
+                                                       size_t n, uint64_t M) {
+  uint64_t lowbits = M * start;
+  for (size_t i = 0; i < n; i += 64) {
+    size_t end = n - i < 64 ? n - i : 64;
+    uint64_t word = 0;
+    for (size_t j = 0; j < end; j++) {
+      word |= (uint64_t)(lowbits <= M - 1) << j;
+      lowbits += M;
+    }
+    bits[i / 64] |= word;
+  }
+}
+
+#ifdef FASTMOD_BATCH_SSE41
+
+// SSE4.1 lacks 64-bit comparisons, we compare the 32-bit halves: in the
+// high half of each 64-bit lane, returns all ones where lowbits > M - 1,
+// that is, where d does not divide the value.
+FASTMOD_TARGET_SSE41
+static inline __m128i is_not_divisible_sse41_lanes(__m128i lowbits,
+                                                   __m128i flippedMm1) {
+  const __m128i sign = _mm_set1_epi32(INT32_MIN);
+  __m128i flipped = _mm_xor_si128(lowbits, sign);
+  __m128i gt = _mm_cmpgt_epi32(flipped, flippedMm1);
+  __m128i eq = _mm_cmpeq_epi32(flipped, flippedMm1);
+  return _mm_or_si128(gt, _mm_and_si128(eq, _mm_slli_epi64(gt, 32)));
+}
+
+FASTMOD_TARGET_SSE41
+FASTMOD_BATCH_API void is_divisible_u32_batch_sse41(const uint32_t *in,
+                                                    uint64_t *bits, size_t n,
+                                                    uint64_t M) {
+  const __m128i Mlo = _mm_set1_epi64x((long long)(M & 0xFFFFFFFF));
+  const __m128i Mhi = _mm_set1_epi64x((long long)(M >> 32));
+  // flip the most significant bit of both 32-bit halves
+  const __m128i flippedMm1 = _mm_xor_si128(_mm_set1_epi64x((long long)(M - 1)),
+                                           _mm_set1_epi32(INT32_MIN));
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    uint64_t word = 0;
+    for (size_t j = 0; j < 64; j += 4) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(in + i + j));
+      __m128i aodd = _mm_srli_epi64(a, 32);
+      __m128i even = _mm_add_epi64(_mm_mul_epu32(Mlo, a),
+                                   _mm_slli_epi64(_mm_mul_epu32(Mhi, a), 32));
+      __m128i odd = _mm_add_epi64(
+          _mm_mul_epu32(Mlo, aodd),
+          _mm_slli_epi64(_mm_mul_epu32(Mhi, aodd), 32));
+      __m128i fails = _mm_blend_epi16(
+          _mm_srli_epi64(is_not_divisible_sse41_lanes(even, flippedMm1), 32),
+          is_not_divisible_sse41_lanes(odd, flippedMm1), 0xCC);
+      uint64_t mask =
+          (uint64_t)(_mm_movemask_ps(_mm_castsi128_ps(fails)) ^ 0xF);
+      word |= mask << j;
+    }
+    bits[i / 64] = word;
+  }
+  is_divisible_u32_batch_scalar(in + i, bits + i / 64, n - i, M);
+}
+
+#endif // FASTMOD_BATCH_SSE41
+
+#ifdef FASTMOD_BATCH_AVX2
+
+// AVX2 only compares signed 64-bit integers: flipping the most significant
+// bit of both sides gives the unsigned comparison. Returns all ones in
+// the 64-bit lanes where lowbits > M - 1, that is, where d does not
+// divide the value.
+FASTMOD_TARGET_AVX2
+static inline __m256i is_not_divisible_avx2_lanes(__m256i lowbits,
+                                                  __m256i flippedMm1) {
+  const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+  return _mm256_cmpgt_epi64(_mm256_xor_si256(lowbits, sign), flippedMm1);
+}
+
+FASTMOD_TARGET_AVX2
+FASTMOD_BATCH_API void is_divisible_u32_batch_avx2(const uint32_t *in,
+                                                   uint64_t *bits, size_t n,
+                                                   uint64_t M) {
+  const __m256i Mlo = _mm256_set1_epi64x((long long)(M & 0xFFFFFFFF));
+  const __m256i Mhi = _mm256_set1_epi64x((long long)(M >> 32));
+  const __m256i flippedMm1 =
+      _mm256_set1_epi64x((long long)((M - 1) ^ UINT64_C(0x8000000000000000)));
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    uint64_t word = 0;
+    for (size_t j = 0; j < 64; j += 8) {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(in + i + j));
+      __m256i aodd = _mm256_srli_epi64(a, 32);
+      // lowbits = M * a (mod 2^64)
+      __m256i even = _mm256_add_epi64(
+          _mm256_mul_epu32(Mlo, a),
+          _mm256_slli_epi64(_mm256_mul_epu32(Mhi, a), 32));
+      __m256i odd = _mm256_add_epi64(
+          _mm256_mul_epu32(Mlo, aodd),
+          _mm256_slli_epi64(_mm256_mul_epu32(Mhi, aodd), 32));
+      // the comparison fills whole lanes, so the 32-bit halves are in order
+      __m256i fails = _mm256_blend_epi32(
+          is_not_divisible_avx2_lanes(even, flippedMm1),
+          is_not_divisible_avx2_lanes(odd, flippedMm1), 0xAA);
+      uint64_t mask =
+          (uint64_t)(_mm256_movemask_ps(_mm256_castsi256_ps(fails)) ^ 0xFF);
+      word |= mask << j;
+    }
+    bits[i / 64] = word;
+  }
+  is_divisible_u32_batch_scalar(in + i, bits + i / 64, n - i, M);
+}
+
+FASTMOD_TARGET_AVX2
+FASTMOD_BATCH_API void mark_divisible_u32_range_avx2(uint32_t start,
+                                                     uint64_t *bits, size_t n,
+                                                     uint64_t M) {
+  const __m256i flippedMm1 =
+      _mm256_set1_epi64x((long long)((M - 1) ^ UINT64_C(0x8000000000000000)));
+  const __m256i step = _mm256_set1_epi64x((long long)(4 * M));
+  uint64_t lowbits = M * start;
+  __m256i v = _mm256_set_epi64x(
+      (long long)(lowbits + 3 * M), (long long)(lowbits + 2 * M),
+      (long long)(lowbits + M), (long long)lowbits);
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    uint64_t word = 0;
+    for (size_t j = 0; j < 64; j += 4) {
+      __m256i fails = is_not_divisible_avx2_lanes(v, flippedMm1);
+      uint64_t mask =
+          (uint64_t)(_mm256_movemask_pd(_mm256_castsi256_pd(fails)) ^ 0xF);
+      word |= mask << j;
+      v = _mm256_add_epi64(v, step);
+    }
+    bits[i / 64] |= word;
+  }
+  mark_divisible_u32_range_scalar(start + (uint32_t)i, bits + i / 64, n - i,
+                                  M);
+}
+
+#endif // FASTMOD_BATCH_AVX2
+
+#ifdef FASTMOD_BATCH_AVX512
+
+FASTMOD_TARGET_AVX512
+FASTMOD_BATCH_API void is_divisible_u32_batch_avx512(const uint32_t *in,
+                                                     uint64_t *bits, size_t n,
+                                                     uint64_t M) {
+  const __m512i Mlo = _mm512_set1_epi64((long long)(M & 0xFFFFFFFF));
+  const __m512i Mhi = _mm512_set1_epi64((long long)(M >> 32));
+  const __m512i Mm1 = _mm512_set1_epi64((long long)(M - 1));
+  const __m512i ones = _mm512_set1_epi64(-1);
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    uint64_t word = 0;
+    for (size_t j = 0; j < 64; j += 16) {
+      __m512i a = _mm512_loadu_si512((const void *)(in + i + j));
+      __m512i aodd = _mm512_srli_epi64(a, 32);
+      __m512i even = _mm512_add_epi64(
+          _mm512_mul_epu32(Mlo, a),
+          _mm512_slli_epi64(_mm512_mul_epu32(Mhi, a), 32));
+      __m512i odd = _mm512_add_epi64(
+          _mm512_mul_epu32(Mlo, aodd),
+          _mm512_slli_epi64(_mm512_mul_epu32(Mhi, aodd), 32));
+      // widen the two comparison masks to whole lanes, interleave their
+      // 32-bit halves and narrow back so that the bits are in order
+      __m512i divisible = _mm512_mask_blend_epi32(
+          0xAAAA,
+          _mm512_maskz_mov_epi64(_mm512_cmple_epu64_mask(even, Mm1), ones),
+          _mm512_maskz_mov_epi64(_mm512_cmple_epu64_mask(odd, Mm1), ones));
+      word |= (uint64_t)_mm512_test_epi32_mask(divisible, divisible) << j;
+    }
+    bits[i / 64] = word;
+  }
+  is_divisible_u32_batch_scalar(in + i, bits + i / 64, n - i, M);
+}
+
+FASTMOD_TARGET_AVX512
+FASTMOD_BATCH_API void mark_divisible_u32_range_avx512(uint32_t start,
+                                                       uint64_t *bits,
+                                                       size_t n, uint64_t M) {
+  const __m512i Mm1 = _mm512_set1_epi64((long long)(M - 1));
+  const __m512i step = _mm512_set1_epi64((long long)(8 * M));
+  uint64_t lowbits = M * start;
+  __m512i v = _mm512_set_epi64(
+      (long long)(lowbits + 7 * M), (long long)(lowbits + 6 * M),
+      (long long)(lowbits + 5 * M), (long long)(lowbits + 4 * M),
+      (long long)(lowbits + 3 * M), (long long)(lowbits + 2 * M),
+      (long long)(lowbits + M), (long long)lowbits);
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    uint64_t word = 0;
+    for (size_t j = 0; j < 64; j += 8) {
+      word |= (uint64_t)_mm512_cmple_epu64_mask(v, Mm1) << j;
+      v = _mm512_add_epi64(v, step);
+    }
+    bits[i / 64] |= word;
+  }
+  mark_divisible_u32_range_scalar(start + (uint32_t)i, bits + i / 64, n - i,
+                                  M);
+}
+
+#endif // FASTMOD_BATCH_AVX512
+
+// bit i of the bitmap is set when in[i] is divisible by d given precomputed
+// M, uses the widest kernel available
+FASTMOD_BATCH_API void is_divisible_u32_batch(const uint32_t *in,
+                                              uint64_t *bits, size_t n,
+                                              uint64_t M) {
+#if defined(__AVX512F__)
+  is_divisible_u32_batch_avx512(in, bits, n, M);
+#elif defined(__AVX2__)
+  is_divisible_u32_batch_avx2(in, bits, n, M);
+#elif defined(__SSE4_1__)
+  is_divisible_u32_batch_sse41(in, bits, n, M);
+#else
+  is_divisible_u32_batch_scalar(in, bits, n, M);
+#endif
+}
+
+// sets bit j of the bitmap when start + j is divisible by d given
+// precomputed M, requires start + n <= 2^32, uses the widest kernel
+// available
+FASTMOD_BATCH_API void mark_divisible_u32_range(uint32_t start, uint64_t *bits,
+                                                size_t n, uint64_t M) {
+#if defined(__AVX512F__)
+  mark_divisible_u32_range_avx512(start, bits, n, M);
+#elif defined(__AVX2__)
+  mark_divisible_u32_range_avx2(start, bits, n, M);
+#else
+  mark_divisible_u32_range_scalar(start, bits, n, M);
+#endif
+}
+
+// sets bit j of the bitmap when start + j is divisible by one of the count
+// divisors with precomputed M[0], ..., M[count - 1] and clears it
+// otherwise, requires start + n <= 2^32. With the primes up to sqrt(start + n) as
+// divisors and start past the largest of them, the clear bits are the
+// primes of the segment.
+FASTMOD_BATCH_API void sieve_u32_segment(uint32_t start, uint64_t *bits,
+                                         size_t n, const uint64_t *M,
+                                         size_t count) {
+  for (size_t i = 0; i < (n + 63) / 64; i++) {
+    bits[i] = 0;
+  }
+  for (size_t k = 0; k < count; k++) {
+    mark_divisible_u32_range(start, bits, n, M[k]);
+  }
+}
+
+/**
+ * One dividend, many divisors.
+ * Usage:
+ *  uint32_t d[count] = ... ; // non-zero divisors, count <= FASTMOD_MULTI_MAX
+ *  fastmod_u32_multi_t m;
+ *  fastmod_u32_multi_init(&m, d, count); // do once
+ *  fastmod_u32_multi(&m, a, out); // out[k] = a % d[k] for k < count
+ *  fastmod_u32_multi_batch(&m, in, n, out); // out[i * count + k] = in[i] % d[k]
+ *
+ * The divisors and their magic numbers are stored in 64-bit lanes so that
+ * the AVX2 and AVX-512 kernels load four or eight of them at once and
+ * reduce the broadcast dividend by all of them with the same instructions
+ * as fastmod_u32_batch.
+ **/
+
+#define FASTMOD_MULTI_MAX 16
+
+typedef struct {
+  uint64_t M[FASTMOD_MULTI_MAX];
+  uint64_t d[FASTMOD_MULTI_MAX]; // zero-extended to 64 bits
+  size_t count;
+} fastmod_u32_multi_t;
+
+// the unused lanes hold M = 0 and d = 0, they compute zeros; a count above
+// FASTMOD_MULTI_MAX is clamped and the extra divisors are ignored
+FASTMOD_BATCH_API void fastmod_u32_multi_init(fastmod_u32_multi_t *m,
+                                              const uint32_t *d,
+                                              size_t count) {
+  if (count > FASTMOD_MULTI_MAX)
+    count = FASTMOD_MULTI_MAX;
+  for (size_t k = 0; k < FASTMOD_MULTI_MAX; k++) {
+    m->M[k] = k < count ? computeM_u32(d[k]) : 0;
+    m->d[k] = k < count ? d[k] : 0;
+  }
+  m->count = count;
+}
+
+FASTMOD_BATCH_API void fastmod_u32_multi_scalar(const fastmod_u32_multi_t *m,
+                                                uint32_t a, uint32_t *out) {
+  for (size_t k = 0; k < m->count; k++) {
+    out[k] = fastmod_u32(a, m->M[k], (uint32_t)m->d[k]);
+  }
+}
+
+FASTMOD_BATCH_API void
+fastmod_u32_multi_batch_scalar(const fastmod_u32_multi_t *m,
+                               const uint32_t *in, size_t n, uint32_t *out) {
+  for (size_t i = 0; i < n; i++) {
+    fastmod_u32_multi_scalar(m, in[i], out + i * m->count);
+  }
+}
+
+#ifdef FASTMOD_BATCH_AVX2
+
+// Reduces the dividend broadcast in a by the four divisors in the lanes of
+// Mlo, Mhi and d, and stores the min(count, 4) first remainders.
+FASTMOD_TARGET_AVX2
+static inline void fastmod_u32_multi_avx2_store(__m256i a, __m256i Mlo,
+                                                __m256i Mhi, __m256i d,
+                                                uint32_t *out, size_t count) {
+  const __m256i odd = _mm256_setr_epi32(1, 3, 5, 7, 1, 3, 5, 7);
+  __m128i r = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(
+      fastmod_u32_avx2_lanes(a, Mlo, Mhi, d), odd));
+  if (count >= 4) {
+    _mm_storeu_si128((__m128i *)out, r);
+  } else {
+    const __m128i mask = _mm_cmpgt_epi32(_mm_set1_epi32((int)count),
+                                         _mm_setr_epi32(0, 1, 2, 3));
+    _mm_maskstore_epi32((int *)out, mask, r);
+  }
+}
+
+FASTMOD_TARGET_AVX2
+FASTMOD_BATCH_API void
+fastmod_u32_multi_batch_avx2(const fastmod_u32_multi_t *m, const uint32_t *in,
+                             size_t n, uint32_t *out) {
+  __m256i Mlo[FASTMOD_MULTI_MAX / 4];
+  __m256i Mhi[FASTMOD_MULTI_MAX / 4];
+  __m256i d[FASTMOD_MULTI_MAX / 4];
+  const size_t count = m->count;
+  const size_t vectors = (count + 3) / 4;
+  for (size_t v = 0; v < vectors; v++) {
+    Mlo[v] = _mm256_loadu_si256((const __m256i *)(m->M + 4 * v));
+    Mhi[v] = _mm256_srli_epi64(Mlo[v], 32);
+    d[v] = _mm256_loadu_si256((const __m256i *)(m->d + 4 * v));
+  }
+  for (size_t i = 0; i < n; i++) {
+    const __m256i a = _mm256_set1_epi64x((long long)in[i]);
+    for (size_t v = 0; v < vectors; v++) {
+      fastmod_u32_multi_avx2_store(a, Mlo[v], Mhi[v], d[v],
+                                   out + i * count + 4 * v, count - 4 * v);
+    }
+  }
+}
+
+#endif // FASTMOD_BATCH_AVX2
+
+#ifdef FASTMOD_BATCH_AVX512
+
+FASTMOD_TARGET_AVX512
+FASTMOD_BATCH_API void
+fastmod_u32_multi_batch_avx512(const fastmod_u32_multi_t *m,
+                               const uint32_t *in, size_t n, uint32_t *out) {
+  __m512i Mlo[FASTMOD_MULTI_MAX / 8];
+  __m512i Mhi[FASTMOD_MULTI_MAX / 8];
+  __m512i d[FASTMOD_MULTI_MAX / 8];
+  __mmask8 mask[FASTMOD_MULTI_MAX / 8];
+  const size_t count = m->count;
+  const size_t vectors = (count + 7) / 8;
+  for (size_t v = 0; v < vectors; v++) {
+    Mlo[v] = _mm512_loadu_si512((const void *)(m->M + 8 * v));
+    Mhi[v] = _mm512_srli_epi64(Mlo[v], 32);
+    d[v] = _mm512_loadu_si512((const void *)(m->d + 8 * v));
+    mask[v] = count - 8 * v >= 8 ? (__mmask8)0xFF
+                                 : (__mmask8)((1u << (count - 8 * v)) - 1);
+  }
+  for (size_t i = 0; i < n; i++) {
+    const __m512i a = _mm512_set1_epi64((long long)in[i]);
+    for (size_t v = 0; v < vectors; v++) {
+      // the remainders are in the high halves, vpmovqd keeps the low ones
+      __m512i r = _mm512_srli_epi64(
+          fastmod_u32_avx512_lanes(a, Mlo[v], Mhi[v], d[v]), 32);
+      _mm512_mask_cvtepi64_storeu_epi32(out + i * count + 8 * v, mask[v], r);
+    }
+  }
+}
+
+#endif // FASTMOD_BATCH_AVX512
+
+// out[i * count + k] = in[i] % d[k] for the count divisors of m, uses the
+// widest kernel available
+FASTMOD_BATCH_API void fastmod_u32_multi_batch(const fastmod_u32_multi_t *m,
+                                               const uint32_t *in, size_t n,
+                                               uint32_t *out) {
+#if defined(__AVX512F__)
+  fastmod_u32_multi_batch_avx512(m, in, n, out);
+#elif defined(__AVX2__)
+  fastmod_u32_multi_batch_avx2(m, in, n, out);
+#else
+  fastmod_u32_multi_batch_scalar(m, in, n, out);
+#endif
+}
+
+// out[k] = a % d[k] for the count divisors of m
+FASTMOD_BATCH_API void fastmod_u32_multi(const fastmod_u32_multi_t *m,
+                                         uint32_t a, uint32_t *out) {
+  fastmod_u32_multi_batch(m, &a, 1, out);
+}
+
+/**
+ * Array versions of the 16-bit and 8-bit functions.
+ * Usage:
+ *  uint16_t d = ... ; // divisor, should be non-zero
+ *  uint32_t M = computeM_u16(d); // do once
+ *  fastmod_u16_batch(in, out, n, M, d); // out[i] = in[i] % d for i < n
+ *  fastdiv_u16_batch(in, out, n, M); // out[i] = in[i] / d for i < n, d > 1
+ *
+ *  uint8_t d8 = ... ; // divisor, should be non-zero
+ *  uint16_t M8 = computeM_u8(d8); // do once
+ *  fastmod_u8_batch(in8, out8, n, M8, d8); // out8[i] = in8[i] % d8
+ *  fastdiv_u8_batch(in8, out8, n, M8); // out8[i] = in8[i] / d8, d8 > 1
+ *
+ * With AVX2, the products are computed with vpmulhuw and vpmullw on 16
+ * values at once: the 8-bit functions need one or two of them per value
+ * and the 16-bit functions split M into two 16-bit halves.
+ **/
+
+FASTMOD_BATCH_API void fastmod_u16_batch_scalar(const uint16_t *in,
+                                                uint16_t *out, size_t n,
+                                                uint32_t M, uint16_t d) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = fastmod_u16(in[i], M, d);
+  }
+}
+
+FASTMOD_BATCH_API void fastdiv_u16_batch_scalar(const uint16_t *in,
+                                                uint16_t *out, size_t n,
+                                                uint32_t M) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = fastdiv_u16(in[i], M);
+  }
+}
+
+FASTMOD_BATCH_API void fastmod_u8_batch_scalar(const uint8_t *in,
+                                               uint8_t *out, size_t n,
+                                               uint16_t M, uint8_t d) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = fastmod_u8(in[i], M, d);
+  }
+}
+
+FASTMOD_BATCH_API void fastdiv_u8_batch_scalar(const uint8_t *in,
+                                               uint8_t *out, size_t n,
+                                               uint16_t M) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = fastdiv_u8(in[i], M);
+  }
+}
+
+#ifdef FASTMOD_BATCH_AVX2
+
+// (M * a) >> 32 in each 16-bit lane, with M = Mhi 2^16 + Mlo: this is
+// mulhi(a, Mhi) plus the carry out of mullo(a, Mhi) + mulhi(a, Mlo)
+FASTMOD_TARGET_AVX2
+static inline __m256i fastdiv_u16_avx2_lanes(__m256i a, __m256i Mlo,
+                                             __m256i Mhi) {
+  const __m256i bottom = _mm256_mulhi_epu16(a, Mlo);
+  const __m256i middle = _mm256_mullo_epi16(a, Mhi);
+  // a saturated sum differs from the wrapped sum when there is a carry
+  const __m256i nocarry =
+      _mm256_cmpeq_epi16(_mm256_adds_epu16(middle, bottom),
+                         _mm256_add_epi16(middle, bottom));
+  return _mm256_add_epi16(
+      _mm256_mulhi_epu16(a, Mhi),
+      _mm256_add_epi16(nocarry, _mm256_set1_epi16(1)));
+}
+
+FASTMOD_TARGET_AVX2
+FASTMOD_BATCH_API void fastmod_u16_batch_avx2(const uint16_t *in,
+                                              uint16_t *out, size_t n,
+                                              uint32_t M, uint16_t d) {
+  if (d == 1) {
+    fastmod_u16_batch_scalar(in, out, n, M, d); // the quotient needs d > 1
+    return;
+  }
+  const __m256i Mlo = _mm256_set1_epi16((short)(M & 0xFFFF));
+  const __m256i Mhi = _mm256_set1_epi16((short)(M >> 16));
+  const __m256i vd = _mm256_set1_epi16((short)d);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(in + i));
+    __m256i q = fastdiv_u16_avx2_lanes(a, Mlo, Mhi);
+    _mm256_storeu_si256((__m256i *)(out + i),
+                        _mm256_sub_epi16(a, _mm256_mullo_epi16(q, vd)));
+  }
+  fastmod_u16_batch_scalar(in + i, out + i, n - i, M, d);
+}
+
+FASTMOD_TARGET_AVX2
+FASTMOD_BATCH_API void fastdiv_u16_batch_avx2(const uint16_t *in,
+                                              uint16_t *out, size_t n,
+                                              uint32_t M) {
+  const __m256i Mlo = _mm256_set1_epi16((short)(M & 0xFFFF));
+  const __m256i Mhi = _mm256_set1_epi16((short)(M >> 16));
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(in + i));
+    _mm256_storeu_si256((__m256i *)(out + i),
+                        fastdiv_u16_avx2_lanes(a, Mlo, Mhi));
+  }
+  fastdiv_u16_batch_scalar(in + i, out + i, n - i, M);
+}
+
+// The bytes are widened to 16-bit lanes and packed back: unpacking and
+// packing both work within 128-bit halves, so the order is kept.
+FASTMOD_TARGET_AVX2
+FASTMOD_BATCH_API void fastmod_u8_batch_avx2(const uint8_t *in, uint8_t *out,
+                                             size_t n, uint16_t M, uint8_t d) {
+  const __m256i vM = _mm256_set1_epi16((short)M);
+  const __m256i vd = _mm256_set1_epi16((short)d);
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(in + i));
+    // (lowbits * d) >> 16 with lowbits = M * a (mod 2^16)
+    __m256i lo = _mm256_mulhi_epu16(
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), vM), vd);
+    __m256i hi = _mm256_mulhi_epu16(
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), vM), vd);
+    _mm256_storeu_si256((__m256i *)(out + i), _mm256_packus_epi16(lo, hi));
+  }
+  fastmod_u8_batch_scalar(in + i, out + i, n - i, M, d);
+}
+
+FASTMOD_TARGET_AVX2
+FASTMOD_BATCH_API void fastdiv_u8_batch_avx2(const uint8_t *in, uint8_t *out,
+                                             size_t n, uint16_t M) {
+  const __m256i vM = _mm256_set1_epi16((short)M);
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(in + i));
+    __m256i lo = _mm256_mulhi_epu16(_mm256_unpacklo_epi8(a, zero), vM);
+    __m256i hi = _mm256_mulhi_epu16(_mm256_unpackhi_epi8(a, zero), vM);
+    _mm256_storeu_si256((__m256i *)(out + i), _mm256_packus_epi16(lo, hi));
+  }
+  fastdiv_u8_batch_scalar(in + i, out + i, n - i, M);
+}
+
+#endif // FASTMOD_BATCH_AVX2
+
+// out[i] = in[i] % d given precomputed M, uses AVX2 when available
+FASTMOD_BATCH_API void fastmod_u16_batch(const uint16_t *in, uint16_t *out,
+                                         size_t n, uint32_t M, uint16_t d) {
+#if defined(__AVX2__)
+  fastmod_u16_batch_avx2(in, out, n, M, d);
+#else
+  fastmod_u16_batch_scalar(in, out, n, M, d);
+#endif
+}
+
+// out[i] = in[i] / d given precomputed M for d>1, uses AVX2 when available
+FASTMOD_BATCH_API void fastdiv_u16_batch(const uint16_t *in, uint16_t *out,
+                                         size_t n, uint32_t M) {
+#if defined(__AVX2__)
+  fastdiv_u16_batch_avx2(in, out, n, M);
+#else
+  fastdiv_u16_batch_scalar(in, out, n, M);
+#endif
+}
+
+// out[i] = in[i] % d given precomputed M, uses AVX2 when available
+FASTMOD_BATCH_API void fastmod_u8_batch(const uint8_t *in, uint8_t *out,
+                                        size_t n, uint16_t M, uint8_t d) {
+#if defined(__AVX2__)
+  fastmod_u8_batch_avx2(in, out, n, M, d);
+#else
+  fastmod_u8_batch_scalar(in, out, n, M, d);
+#endif
+}
+
+// out[i] = in[i] / d given precomputed M for d>1, uses AVX2 when available
+FASTMOD_BATCH_API void fastdiv_u8_batch(const uint8_t *in, uint8_t *out,
+                                        size_t n, uint16_t M) {
+#if defined(__AVX2__)
+  fastdiv_u8_batch_avx2(in, out, n, M);
+#else
+  fastdiv_u8_batch_scalar(in, out, n, M);
+#endif
+}
+
+// What follows is the 64-bit functions, they are available wherever
+// computeM_u64 is.
+
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+
+/**
+ * Array versions of the 64-bit functions.
+ * Usage:
+ *  uint64_t d = ... ; // divisor, should be non-zero
+ *  fastmod_u128_t M = computeM_u64(d); // do once
+ *  fastmod_u64_batch(in, out, n, M, d); // out[i] = in[i] % d for i < n
+ *  fastdiv_u64_batch(in, out, n, M); // out[i] = in[i] / d for i < n, d > 1
+ *
+ * When the code is compiled with AVX-512 IFMA support (e.g., -mavx512ifma
+ * or -march=icelake-server), the 128-bit products are computed with
+ * vpmadd52luq/vpmadd52huq over 52-bit limbs, eight values at a time.
+ * Otherwise, we use the scalar (multiword under Visual Studio) functions.
+ **/
+
+FASTMOD_BATCH_API void fastmod_u64_batch_scalar(const uint64_t *in,
+                                                uint64_t *out, size_t n,
+                                                fastmod_u128_t M, uint64_t d) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = fastmod_u64(in[i], M, d);
+  }
+}
+
+FASTMOD_BATCH_API void fastdiv_u64_batch_scalar(const uint64_t *in,
+                                                uint64_t *out, size_t n,
+                                                fastmod_u128_t M) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = fastdiv_u64(in[i], M);
+  }
+}
+
+#ifdef __AVX512IFMA__
+
+// A 128-bit value is split in three 52-bit limbs (the last one has 24 bits)
+// and a 64-bit value in two limbs (the last one has 12 bits). Since
+// vpmadd52luq/vpmadd52huq return the low/high 52 bits of a 52x52-bit
+// product, a column of partial products never has a carry out of its
+// lowest limb, and a few columns add up without overflowing 64 bits.
+
+// Returns the 64 bits of (x2:x1:x0 * y1:y0) starting at bit 128 given the
+// sums of the partial products in columns 1 and 2 (c1 and c2) and
+// the column 3 products.
+static inline __m512i fastmod_u64_ifma_top(__m512i c1, __m512i c2,
+                                           __m512i x1, __m512i x2,
+                                           __m512i y0, __m512i y1) {
+  const __m512i mask52 = _mm512_set1_epi64(INT64_C(0xFFFFFFFFFFFFF));
+  __m512i c3 = _mm512_madd52hi_epu64(_mm512_setzero_si512(), x2, y0);
+  c3 = _mm512_madd52hi_epu64(c3, x1, y1);
+  c3 = _mm512_madd52lo_epu64(c3, x2, y1);
+  // propagate the carries
+  c2 = _mm512_add_epi64(c2, _mm512_srli_epi64(c1, 52));
+  c3 = _mm512_add_epi64(c3, _mm512_srli_epi64(c2, 52));
+  // bit 128 is bit 24 of the column 2 limb
+  return _mm512_or_si512(
+      _mm512_srli_epi64(_mm512_and_si512(c2, mask52), 24),
+      _mm512_slli_epi64(c3, 28));
+}
+
+// Computes the columns 1 and 2 of (x2:x1:x0 * y1:y0), column 0 is
+// the low 52 bits of x0 * y0.
+static inline void fastmod_u64_ifma_low(__m512i x0, __m512i x1, __m512i x2,
+                                        __m512i y0, __m512i y1, __m512i *c1,
+                                        __m512i *c2) {
+  const __m512i zero = _mm512_setzero_si512();
+  __m512i t1 = _mm512_madd52hi_epu64(zero, x0, y0);
+  t1 = _mm512_madd52lo_epu64(t1, x1, y0);
+  t1 = _mm512_madd52lo_epu64(t1, x0, y1);
+  __m512i t2 = _mm512_madd52hi_epu64(zero, x1, y0);
+  t2 = _mm512_madd52hi_epu64(t2, x0, y1);
+  t2 = _mm512_madd52lo_epu64(t2, x2, y0);
+  t2 = _mm512_madd52lo_epu64(t2, x1, y1);
+  *c1 = t1;
+  *c2 = t2;
+}
+
+FASTMOD_BATCH_API void fastmod_u64_batch_ifma(const uint64_t *in,
+                                              uint64_t *out, size_t n,
+                                              fastmod_u128_t M, uint64_t d) {
+  const __m512i mask52 = _mm512_set1_epi64(INT64_C(0xFFFFFFFFFFFFF));
+  const __m512i mask24 = _mm512_set1_epi64(INT64_C(0xFFFFFF));
+  const __m512i m0 = _mm512_set1_epi64((long long)((uint64_t)M & UINT64_C(0xFFFFFFFFFFFFF)));
+  const __m512i m1 = _mm512_set1_epi64((long long)((uint64_t)(M >> 52) & UINT64_C(0xFFFFFFFFFFFFF)));
+  const __m512i m2 = _mm512_set1_epi64((long long)(uint64_t)(M >> 104));
+  const __m512i d0 = _mm512_set1_epi64((long long)(d & UINT64_C(0xFFFFFFFFFFFFF)));
+  const __m512i d1 = _mm512_set1_epi64((long long)(d >> 52));
+  const __m512i zero = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512i a = _mm512_loadu_si512((const void *)(in + i));
+    __m512i a0 = _mm512_and_si512(a, mask52);
+    __m512i a1 = _mm512_srli_epi64(a, 52);
+    // lowbits = M * a (mod 2^128)
+    __m512i c1, c2;
+    fastmod_u64_ifma_low(m0, m1, m2, a0, a1, &c1, &c2);
+    __m512i l0 = _mm512_madd52lo_epu64(zero, m0, a0);
+    c2 = _mm512_add_epi64(c2, _mm512_srli_epi64(c1, 52));
+    __m512i l1 = _mm512_and_si512(c1, mask52);
+    __m512i l2 = _mm512_and_si512(c2, mask24);
+    // (lowbits * d) >> 128
+    fastmod_u64_ifma_low(l0, l1, l2, d0, d1, &c1, &c2);
+    _mm512_storeu_si512((void *)(out + i),
+                        fastmod_u64_ifma_top(c1, c2, l1, l2, d0, d1));
+  }
+  fastmod_u64_batch_scalar(in + i, out + i, n - i, M, d);
+}
+
+FASTMOD_BATCH_API void fastdiv_u64_batch_ifma(const uint64_t *in,
+                                              uint64_t *out, size_t n,
+                                              fastmod_u128_t M) {
+  const __m512i mask52 = _mm512_set1_epi64(INT64_C(0xFFFFFFFFFFFFF));
+  const __m512i m0 = _mm512_set1_epi64((long long)((uint64_t)M & UINT64_C(0xFFFFFFFFFFFFF)));
+  const __m512i m1 = _mm512_set1_epi64((long long)((uint64_t)(M >> 52) & UINT64_C(0xFFFFFFFFFFFFF)));
+  const __m512i m2 = _mm512_set1_epi64((long long)(uint64_t)(M >> 104));
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512i a = _mm512_loadu_si512((const void *)(in + i));
+    __m512i a0 = _mm512_and_si512(a, mask52);
+    __m512i a1 = _mm512_srli_epi64(a, 52);
+    // (M * a) >> 128
+    __m512i c1, c2;
+    fastmod_u64_ifma_low(m0, m1, m2, a0, a1, &c1, &c2);
+    _mm512_storeu_si512((void *)(out + i),
+                        fastmod_u64_ifma_top(c1, c2, m1, m2, a0, a1));
+  }
+  fastdiv_u64_batch_scalar(in + i, out + i, n - i, M);
+}
+
+#endif // __AVX512IFMA__
+
+// out[i] = in[i] % d given precomputed M, uses AVX-512 IFMA if available
+FASTMOD_BATCH_API void fastmod_u64_batch(const uint64_t *in, uint64_t *out,
+                                         size_t n, fastmod_u128_t M,
+                                         uint64_t d) {
+#ifdef __AVX512IFMA__
+  fastmod_u64_batch_ifma(in, out, n, M, d);
+#else
+  fastmod_u64_batch_scalar(in, out, n, M, d);
+#endif
+}
+
+// out[i] = in[i] / d given precomputed M for d>1, uses AVX-512 IFMA if
+// available
+FASTMOD_BATCH_API void fastdiv_u64_batch(const uint64_t *in, uint64_t *out,
+                                         size_t n, fastmod_u128_t M) {
+#ifdef __AVX512IFMA__
+  fastdiv_u64_batch_ifma(in, out, n, M);
+#else
+  fastdiv_u64_batch_scalar(in, out, n, M);
+#endif
+}
+
+#endif // 64-bit functions
+
+#ifdef __cplusplus
+} // fastmod
+#endif
+
+#undef FASTMOD_BATCH_API
+
+#ifdef FASTMOD_BATCH_POP_DIAGNOSTIC
+#undef FASTMOD_BATCH_POP_DIAGNOSTIC
+#pragma GCC diagnostic pop
+#endif
+
+#endif // FASTMOD_BATCH_H
@@ -0,0 +1,228 @@
+#ifndef FASTMOD_DISPATCH_H
+#define FASTMOD_DISPATCH_H
+
+#include "fastmod_batch.h"
+
+#ifndef __cplusplus
+#include <stdlib.h>
+#include <string.h>
+#else
+#include <cstdlib>
+#include <cstring>
+#endif
+
+#if defined(FASTMOD_RUNTIME_KERNELS) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifndef __cplusplus
+#define FASTMOD_DISPATCH_API static inline
+#else
+#define FASTMOD_DISPATCH_API inline
+#endif
+
+#ifdef __cplusplus
+namespace fastmod {
+#endif
+
+/**
+ * Runtime dispatch of the 32-bit batch functions.
+ * Usage:
+ *  fastmod_u32_batch_dispatch(in, out, n, M, d); // out[i] = in[i] % d
+ *  fastdiv_u32_batch_dispatch(in, out, n, M); // out[i] = in[i] / d, d > 1
+ *  is_divisible_u32_batch_dispatch(in, bits, n, M); // see
+ *                                                   // is_divisible_u32_batch
+ *  computeM_u32_batch_dispatch(d, M, n); // M[i] = computeM_u32(d[i])
+ *  fastmod_dispatch_name() // is "scalar", "sse4.1", "avx2" or "avx512"
+ *
+ * Unlike fastmod_u32_batch, which uses the kernels enabled at compile time,
+ * these functions query the processor (CPUID) once and call the widest
+ * kernel it supports, so a binary built for baseline x86-64 still gets the
+ * AVX2 or AVX-512 code. Other systems always use the scalar kernel.
+ *
+ * For A/B runs, set the environment variable FASTMOD_DISPATCH to one of
+ * the names above, or call fastmod_dispatch_select(name) before starting
+ * threads. A kernel that the processor does not support is never picked.
+ * In C, each translation unit keeps its own choice.
+ **/
+
+typedef struct {
+  const char *name;
+  void (*fastmod_u32)(const uint32_t *, uint32_t *, size_t, uint64_t,
+                      uint32_t);
+  void (*fastdiv_u32)(const uint32_t *, uint32_t *, size_t, uint64_t);
+  void (*is_divisible_u32)(const uint32_t *, uint64_t *, size_t, uint64_t);
+  void (*computeM_u32)(const uint32_t *, uint64_t *, size_t);
+} fastmod_dispatch_t;
+
+// The kernels from the slowest to the fastest, returns NULL past the end.
+FASTMOD_DISPATCH_API const fastmod_dispatch_t *fastmod_dispatch_kernel(int k) {
+  static const fastmod_dispatch_t kernels[] = {
+      {"scalar", fastmod_u32_batch_scalar, fastdiv_u32_batch_scalar,
+       is_divisible_u32_batch_scalar, computeM_u32_batch_scalar},
+#ifdef FASTMOD_RUNTIME_KERNELS
+      // computeM_u32 has no SSE4.1 kernel, and AVX-512 has AVX2
+      {"sse4.1", fastmod_u32_batch_sse41, fastdiv_u32_batch_sse41,
+       is_divisible_u32_batch_sse41, computeM_u32_batch_scalar},
+      {"avx2", fastmod_u32_batch_avx2, fastdiv_u32_batch_avx2,
+       is_divisible_u32_batch_avx2, computeM_u32_batch_avx2},
+      {"avx512", fastmod_u32_batch_avx512, fastdiv_u32_batch_avx512,
+       is_divisible_u32_batch_avx512, computeM_u32_batch_avx2},
+#endif
+  };
+  if (k < 0 || (size_t)k >= sizeof(kernels) / sizeof(kernels[0]))
+    return NULL;
+  return &kernels[k];
+}
+
+// tells you whether the processor (and the operating system) supports the
+// kernel fastmod_dispatch_kernel(k)
+FASTMOD_DISPATCH_API bool fastmod_dispatch_supported(int k) {
+#if defined(FASTMOD_RUNTIME_KERNELS) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  const int max_leaf = info[0];
+  __cpuid(info, 1);
+  const bool sse41 = (info[2] & (1 << 19)) != 0;
+  // the operating system must save the AVX (and AVX-512) registers
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+  int leaf7[4] = {0, 0, 0, 0};
+  if (max_leaf >= 7)
+    __cpuidex(leaf7, 7, 0);
+  const bool avx2 = ((xcr0 & 0x6) == 0x6) && (leaf7[1] & (1 << 5)) != 0;
+  const bool avx512 = ((xcr0 & 0xE6) == 0xE6) && (leaf7[1] & (1 << 16)) != 0;
+  switch (k) {
+  case 0:
+    return true;
+  case 1:
+    return sse41;
+  case 2:
+    return avx2;
+  case 3:
+    return avx512;
+  default:
+    return false;
+  }
+#elif defined(FASTMOD_RUNTIME_KERNELS)
+  // the builtins run CPUID and check the operating system support
+  __builtin_cpu_init();
+  switch (k) {
+  case 0:
+    return true;
+  case 1:
+    return __builtin_cpu_supports("sse4.1");
+  case 2:
+    return __builtin_cpu_supports("avx2");
+  case 3:
+    return __builtin_cpu_supports("avx512f");
+  default:
+    return false;
+  }
+#else
+  return k == 0;
+#endif
+}
+
+// the kernel called name if the processor supports it, NULL otherwise
+FASTMOD_DISPATCH_API const fastmod_dispatch_t *
+fastmod_dispatch_find(const char *name) {
+  const fastmod_dispatch_t *kernel;
+  for (int k = 0; (kernel = fastmod_dispatch_kernel(k)) != NULL; k++) {
+    if (strcmp(kernel->name, name) == 0)
+      return fastmod_dispatch_supported(k) ? kernel : NULL;
+  }
+  return NULL;
+}
+
+// the kernel named by FASTMOD_DISPATCH if any, otherwise the widest one
+FASTMOD_DISPATCH_API const fastmod_dispatch_t *fastmod_dispatch_detect(void) {
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4996) // getenv is fine, we only read the variable
+#endif
+  const char *name = getenv("FASTMOD_DISPATCH");
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+  const fastmod_dispatch_t *best = NULL;
+  if (name != NULL)
+    best = fastmod_dispatch_find(name);
+  for (int k = 0; best == NULL; k++) {
+    const fastmod_dispatch_t *kernel = fastmod_dispatch_kernel(k);
+    if (kernel == NULL || !fastmod_dispatch_supported(k))
+      best = fastmod_dispatch_kernel(k - 1);
+  }
+  return best;
+}
+
+FASTMOD_DISPATCH_API const fastmod_dispatch_t **fastmod_dispatch_current(void) {
+#ifdef __cplusplus
+  static const fastmod_dispatch_t *current = fastmod_dispatch_detect();
+#else
+  static const fastmod_dispatch_t *current = NULL;
+  if (current == NULL)
+    current = fastmod_dispatch_detect();
+#endif
+  return &current;
+}
+
+#if !defined(__cplusplus) && defined(FASTMOD_RUNTIME_KERNELS) &&               \
+    defined(__GNUC__)
+// In C, we pick the kernel when the program starts so that the first calls
+// from several threads do not race.
+__attribute__((constructor)) static void fastmod_dispatch_init(void) {
+  (void)fastmod_dispatch_current();
+}
+#endif
+
+// the name of the kernel in use
+FASTMOD_DISPATCH_API const char *fastmod_dispatch_name(void) {
+  return (*fastmod_dispatch_current())->name;
+}
+
+// switches to the kernel called name, returns false (and keeps the current
+// kernel) if there is no such kernel or if the processor does not support it
+FASTMOD_DISPATCH_API bool fastmod_dispatch_select(const char *name) {
+  const fastmod_dispatch_t *kernel = fastmod_dispatch_find(name);
+  if (kernel == NULL)
+    return false;
+  *fastmod_dispatch_current() = kernel;
+  return true;
+}
+
+// out[i] = in[i] % d given precomputed M
+FASTMOD_DISPATCH_API void fastmod_u32_batch_dispatch(const uint32_t *in,
+                                                     uint32_t *out, size_t n,
+                                                     uint64_t M, uint32_t d) {
+  (*fastmod_dispatch_current())->fastmod_u32(in, out, n, M, d);
+}
+
+// out[i] = in[i] / d given precomputed M for d>1
+FASTMOD_DISPATCH_API void fastdiv_u32_batch_dispatch(const uint32_t *in,
+                                                     uint32_t *out, size_t n,
+                                                     uint64_t M) {
+  (*fastmod_dispatch_current())->fastdiv_u32(in, out, n, M);
+}
+
+// bit i of the bitmap is set when in[i] is divisible by d given precomputed M
+FASTMOD_DISPATCH_API void is_divisible_u32_batch_dispatch(const uint32_t *in,
+                                                          uint64_t *bits,
+                                                          size_t n,
+                                                          uint64_t M) {
+  (*fastmod_dispatch_current())->is_divisible_u32(in, bits, n, M);
+}
+
+// M[i] = computeM_u32(d[i]) for non-zero divisors
+FASTMOD_DISPATCH_API void computeM_u32_batch_dispatch(const uint32_t *d,
+                                                      uint64_t *M, size_t n) {
+  (*fastmod_dispatch_current())->computeM_u32(d, M, n);
+}
+
+#ifdef __cplusplus
+} // fastmod
+#endif
+
+#undef FASTMOD_DISPATCH_API
+
+#endif // FASTMOD_DISPATCH_H
@@ -0,0 +1,378 @@
+#ifndef FASTMOD_HASHMAP_H
+#define FASTMOD_HASHMAP_H
+
+#include "fastmod.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace fastmod {
+
+/**
+ * Open-addressing hash map and set whose capacity is a prime number.
+ * Usage:
+ *  fastmod::hash_map<uint64_t, int> map;
+ *  map[key] = 1; // or map.insert(key, 1)
+ *  int *value = map.find(key); // nullptr if the key is absent
+ *  map.erase(key);
+ *
+ *  fastmod::hash_set<uint64_t> set;
+ *  set.insert(key);
+ *  set.contains(key);
+ *
+ * The capacities come from hash_primes, a table of primes along with their
+ * magic numbers, computed at compile time. Hash values are mapped to slots
+ * with fastmod_u32 so that neither probing nor rehashing executes a
+ * division instruction. Keys and values must be default constructible.
+ **/
+
+// A prime and its magic number, M = computeM_u32(prime)
+struct prime_entry {
+  uint32_t prime;
+  uint64_t M;
+};
+
+// computeM_u32 spelled out, so that it is a constant expression in C++11
+#define FASTMOD_PRIME_ENTRY(p) {p, UINT64_C(0xFFFFFFFFFFFFFFFF) / p + 1}
+
+// Each prime is the smallest prime larger than twice the previous one,
+// except the last, which is the largest 32-bit prime.
+constexpr prime_entry hash_primes[] = {
+    FASTMOD_PRIME_ENTRY(7u), FASTMOD_PRIME_ENTRY(17u), FASTMOD_PRIME_ENTRY(37u),
+    FASTMOD_PRIME_ENTRY(79u), FASTMOD_PRIME_ENTRY(163u), FASTMOD_PRIME_ENTRY(331u),
+    FASTMOD_PRIME_ENTRY(673u), FASTMOD_PRIME_ENTRY(1361u), FASTMOD_PRIME_ENTRY(2729u),
+    FASTMOD_PRIME_ENTRY(5471u), FASTMOD_PRIME_ENTRY(10949u), FASTMOD_PRIME_ENTRY(21911u),
+    FASTMOD_PRIME_ENTRY(43853u), FASTMOD_PRIME_ENTRY(87719u), FASTMOD_PRIME_ENTRY(175447u),
+    FASTMOD_PRIME_ENTRY(350899u), FASTMOD_PRIME_ENTRY(701819u), FASTMOD_PRIME_ENTRY(1403641u),
+    FASTMOD_PRIME_ENTRY(2807303u), FASTMOD_PRIME_ENTRY(5614657u), FASTMOD_PRIME_ENTRY(11229331u),
+    FASTMOD_PRIME_ENTRY(22458671u), FASTMOD_PRIME_ENTRY(44917381u), FASTMOD_PRIME_ENTRY(89834777u),
+    FASTMOD_PRIME_ENTRY(179669557u), FASTMOD_PRIME_ENTRY(359339171u), FASTMOD_PRIME_ENTRY(718678369u),
+    FASTMOD_PRIME_ENTRY(1437356741u), FASTMOD_PRIME_ENTRY(2874713497u), FASTMOD_PRIME_ENTRY(4294967291u)};
+
+#undef FASTMOD_PRIME_ENTRY
+
+constexpr size_t hash_primes_count =
+    sizeof(hash_primes) / sizeof(hash_primes[0]);
+
+// Capacity policy: the capacity is a prime from hash_primes and hash values
+// are reduced with fastmod_u32.
+class prime_capacity {
+public:
+  prime_capacity() : M(hash_primes[0].M), d(hash_primes[0].prime) {}
+
+  // picks the smallest capacity no smaller than n, returns false if none
+  bool resize(size_t n) {
+    size_t i = 0;
+    while (hash_primes[i].prime < n) {
+      if (++i == hash_primes_count) {
+        return false;
+      }
+    }
+    M = hash_primes[i].M;
+    d = hash_primes[i].prime;
+    return true;
+  }
+  size_t size() const { return d; }
+  size_t bucket(size_t hash) const {
+    uint64_t h = uint64_t(hash);
+    return fastmod_u32(uint32_t(h ^ (h >> 32)), M, d);
+  }
+
+private:
+  uint64_t M;
+  uint32_t d;
+};
+
+// Capacity policy: the capacity is a power of two and hash values are
+// reduced with a mask. Provided for comparison.
+class power_of_two_capacity {
+public:
+  power_of_two_capacity() : mask(7) {}
+
+  bool resize(size_t n) {
+    size_t c = 8;
+    while (c < n) {
+      c <<= 1;
+      if (c == 0) {
+        return false;
+      }
+    }
+    mask = c - 1;
+    return true;
+  }
+  size_t size() const { return mask + 1; }
+  size_t bucket(size_t hash) const {
+    uint64_t h = uint64_t(hash);
+    return size_t(h ^ (h >> 32)) & mask;
+  }
+
+private:
+  size_t mask;
+};
+
+namespace detail {
+
+// Linear probing over slots that have a 'key' member. Erased slots are
+// marked as deleted (tombstones) and reclaimed when the table is rebuilt.
+template <class Slot, class Key, class Hash, class KeyEqual, class Capacity>
+class open_table {
+public:
+  static const size_t npos = size_t(-1);
+
+  open_table() : states(capacity.size(), empty), slots(capacity.size()) {}
+
+  size_t size() const { return count; }
+  size_t slot_count() const { return slots.size(); }
+  bool is_full(size_t i) const { return states[i] == full; }
+  Slot &at(size_t i) { return slots[i]; }
+  const Slot &at(size_t i) const { return slots[i]; }
+
+  // returns the slot holding key, or npos
+  size_t find(const Key &key) const {
+    size_t i = capacity.bucket(hasher(key));
+    while (true) {
+      if (states[i] == empty) {
+        return npos;
+      }
+      if (states[i] == full && equal(slots[i].key, key)) {
+        return i;
+      }
+      if (++i == slots.size()) {
+        i = 0;
+      }
+    }
+  }
+
+  // returns the slot holding key and whether it was just added, the table
+  // is only rebuilt when the key is missing
+  std::pair<size_t, bool> insert(const Key &key) {
+    size_t i = probe(key);
+    if (states[i] == full) {
+      return std::make_pair(i, false);
+    }
+    if ((count + tombstones + 1) * 10 > slots.size() * 7) {
+      // after rebuilding, the table is at most 35% full
+      rehash((count + 1) * 20 / 7);
+      i = probe(key);
+    }
+    if (states[i] == deleted) {
+      tombstones--;
+    }
+    states[i] = full;
+    slots[i].key = key;
+    count++;
+    return std::make_pair(i, true);
+  }
+
+  void erase_at(size_t i) {
+    states[i] = deleted;
+    slots[i] = Slot();
+    count--;
+    tombstones++;
+  }
+
+  void clear() {
+    states.assign(states.size(), empty);
+    slots.assign(slots.size(), Slot());
+    count = 0;
+    tombstones = 0;
+  }
+
+  // makes room for n keys without rehashing, the table never shrinks
+  void reserve(size_t n) {
+    if (n < count) {
+      n = count;
+    }
+    if ((n + tombstones) * 10 <= slots.size() * 7) {
+      return; // the current capacity suffices
+    }
+    size_t target = n * 10 / 7 + 1;
+    if (target < slots.size()) {
+      target = slots.size(); // drops the tombstones
+    }
+    rehash(target);
+  }
+
+  // rebuilds the table with a capacity of at least n slots
+  void rehash(size_t n) {
+    if (n < count + 1) {
+      n = count + 1;
+    }
+    Capacity new_capacity;
+    if (!new_capacity.resize(n)) {
+      throw std::length_error("fastmod hash table is too large");
+    }
+    // the new (empty) arrays are swapped in
+    std::vector<uint8_t> old_states(new_capacity.size(), empty);
+    std::vector<Slot> old_slots(new_capacity.size());
+    old_states.swap(states);
+    old_slots.swap(slots);
+    capacity = new_capacity;
+    tombstones = 0;
+    for (size_t j = 0; j < old_slots.size(); j++) {
+      if (old_states[j] != full) {
+        continue;
+      }
+      size_t i = capacity.bucket(hasher(old_slots[j].key));
+      while (states[i] != empty) {
+        if (++i == slots.size()) {
+          i = 0;
+        }
+      }
+      states[i] = full;
+      slots[i] = std::move(old_slots[j]);
+    }
+  }
+
+private:
+  enum : uint8_t { empty = 0, full = 1, deleted = 2 };
+
+  // the slot holding key or, when it is missing, the slot that should
+  // receive it: the first tombstone on the way or the empty slot that ends
+  // the probe
+  size_t probe(const Key &key) const {
+    size_t i = capacity.bucket(hasher(key));
+    size_t reuse = npos;
+    while (true) {
+      if (states[i] == empty) {
+        return reuse != npos ? reuse : i;
+      }
+      if (states[i] == deleted) {
+        if (reuse == npos) {
+          reuse = i;
+        }
+      } else if (equal(slots[i].key, key)) {
+        return i;
+      }
+      if (++i == slots.size()) {
+        i = 0;
+      }
+    }
+  }
+
+  Capacity capacity{};
+  Hash hasher{};
+  KeyEqual equal{};
+  std::vector<uint8_t> states;
+  std::vector<Slot> slots;
+  size_t count{0};
+  size_t tombstones{0};
+};
+
+} // namespace detail
+
+template <class Key, class T, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>,
+          class Capacity = prime_capacity>
+class hash_map {
+public:
+  hash_map() {}
+  explicit hash_map(size_t n) { reserve(n); }
+
+  size_t size() const { return table.size(); }
+  bool empty() const { return table.size() == 0; }
+  size_t capacity() const { return table.slot_count(); }
+
+  // adds the key with the given value, returns false (and leaves the map
+  // unchanged) if the key was already present
+  bool insert(const Key &key, const T &value) {
+    std::pair<size_t, bool> r = table.insert(key);
+    if (r.second) {
+      table.at(r.first).value = value;
+    }
+    return r.second;
+  }
+  T &operator[](const Key &key) {
+    return table.at(table.insert(key).first).value;
+  }
+
+  // returns a pointer to the value, or nullptr if the key is absent
+  T *find(const Key &key) {
+    size_t i = table.find(key);
+    return i == table.npos ? nullptr : &table.at(i).value;
+  }
+  const T *find(const Key &key) const {
+    size_t i = table.find(key);
+    return i == table.npos ? nullptr : &table.at(i).value;
+  }
+  bool contains(const Key &key) const { return table.find(key) != table.npos; }
+
+  bool erase(const Key &key) {
+    size_t i = table.find(key);
+    if (i == table.npos) {
+      return false;
+    }
+    table.erase_at(i);
+    return true;
+  }
+  void clear() { table.clear(); }
+  // makes room for n keys without rehashing, never shrinks the table
+  void reserve(size_t n) { table.reserve(n); }
+
+  // calls f(key, value) for every entry
+  template <class F> void for_each(F f) const {
+    for (size_t i = 0; i < table.slot_count(); i++) {
+      if (table.is_full(i)) {
+        f(table.at(i).key, table.at(i).value);
+      }
+    }
+  }
+
+private:
+  struct slot {
+    Key key;
+    T value;
+  };
+  detail::open_table<slot, Key, Hash, KeyEqual, Capacity> table;
+};
+
+template <class Key, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>,
+          class Capacity = prime_capacity>
+class hash_set {
+public:
+  hash_set() {}
+  explicit hash_set(size_t n) { reserve(n); }
+
+  size_t size() const { return table.size(); }
+  bool empty() const { return table.size() == 0; }
+  size_t capacity() const { return table.slot_count(); }
+
+  // returns false if the key was already present
+  bool insert(const Key &key) { return table.insert(key).second; }
+  bool contains(const Key &key) const { return table.find(key) != table.npos; }
+  bool erase(const Key &key) {
+    size_t i = table.find(key);
+    if (i == table.npos) {
+      return false;
+    }
+    table.erase_at(i);
+    return true;
+  }
+  void clear() { table.clear(); }
+  // makes room for n keys without rehashing, never shrinks the table
+  void reserve(size_t n) { table.reserve(n); }
+
+  // calls f(key) for every key
+  template <class F> void for_each(F f) const {
+    for (size_t i = 0; i < table.slot_count(); i++) {
+      if (table.is_full(i)) {
+        f(table.at(i).key);
+      }
+    }
+  }
+
+private:
+  struct slot {
+    Key key;
+  };
+  detail::open_table<slot, Key, Hash, KeyEqual, Capacity> table;
+};
+
+} // namespace fastmod
+
+#endif // FASTMOD_HASHMAP_H
@@ -0,0 +1,178 @@
+#ifndef FASTMOD_PARALLEL_H
+#define FASTMOD_PARALLEL_H
+
+#include "fastmod_dispatch.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fastmod {
+
+/**
+ * Batch functions spread over a pool of threads (C++11), for arrays of
+ * millions of values.
+ * Usage:
+ *  fastmod::batch_pool pool(threads); // do once, 0 is one per hardware thread
+ *  pool.fastmod_u32_batch(in, out, n, M, d); // out[i] = in[i] % d for i < n
+ *  pool.fastdiv_u32_batch(in, out, n, M); // out[i] = in[i] / d for i < n, d>1
+ *  pool.is_divisible_u32_batch(in, bits, n, M); // see is_divisible_u32_batch
+ *  pool.fastmod_u64_batch(in, out, n, M, d); // 64-bit values
+ *  pool.fastdiv_u64_batch(in, out, n, M); // 64-bit values, d>1
+ *  pool.parallel_for(n, f); // calls f(begin, end) on chunks covering [0, n)
+ *
+ * The range is cut into one contiguous chunk per thread whose length is a
+ * multiple of 64 values, and for a given n, thread t always gets chunk t
+ * (static chunking). The results are identical for any number of threads,
+ * and no two threads write to the same cache line or bitmap word. On NUMA
+ * systems, write the arrays for the first time with pool.parallel_for so
+ * that each page is allocated on the node of the thread that later reads
+ * it (first touch), and pin the process with numactl or taskset.
+ *
+ * The 32-bit functions call the runtime-dispatched kernels of
+ * fastmod_dispatch.h. The calling thread processes chunk 0, so a pool of
+ * t threads starts t - 1 workers. Ranges with fewer than min_chunk values
+ * per thread use fewer threads. A pool runs one call at a time, and f must
+ * not throw.
+ **/
+class batch_pool {
+public:
+  // the smallest number of values worth waking a thread for
+  static const size_t min_chunk = 1 << 16;
+
+  explicit batch_pool(size_t threads = 0) {
+    if (threads == 0)
+      threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+      threads = 1;
+    for (size_t t = 1; t < threads; t++) {
+      workers.emplace_back(&batch_pool::work, this, t);
+    }
+  }
+
+  ~batch_pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers) {
+      worker.join();
+    }
+  }
+
+  batch_pool(const batch_pool &) = delete;
+  batch_pool &operator=(const batch_pool &) = delete;
+
+  // number of threads, including the calling thread
+  size_t size() const { return workers.size() + 1; }
+
+  template <class F> void parallel_for(size_t n, F f) {
+    size_t threads = (n + min_chunk - 1) / min_chunk;
+    if (threads > size())
+      threads = size();
+    if (threads <= 1) {
+      if (n > 0)
+        f(size_t(0), n);
+      return;
+    }
+    size_t chunk = (n + threads - 1) / threads;
+    chunk = (chunk + 63) & ~size_t(63);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job = f;
+      job_n = n;
+      job_chunk = chunk;
+      pending = workers.size();
+      generation++;
+    }
+    wake.notify_all();
+    f(size_t(0), chunk < n ? chunk : n);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return pending == 0; });
+    job = nullptr;
+  }
+
+  // out[i] = in[i] % d given precomputed M
+  void fastmod_u32_batch(const uint32_t *in, uint32_t *out, size_t n,
+                         uint64_t M, uint32_t d) {
+    parallel_for(n, [=](size_t begin, size_t end) {
+      fastmod_u32_batch_dispatch(in + begin, out + begin, end - begin, M, d);
+    });
+  }
+
+  // out[i] = in[i] / d given precomputed M for d>1
+  void fastdiv_u32_batch(const uint32_t *in, uint32_t *out, size_t n,
+                         uint64_t M) {
+    parallel_for(n, [=](size_t begin, size_t end) {
+      fastdiv_u32_batch_dispatch(in + begin, out + begin, end - begin, M);
+    });
+  }
+
+  // bit i of the bitmap is set when in[i] is divisible by d given
+  // precomputed M, the chunks start on a word of the bitmap
+  void is_divisible_u32_batch(const uint32_t *in, uint64_t *bits, size_t n,
+                              uint64_t M) {
+    parallel_for(n, [=](size_t begin, size_t end) {
+      is_divisible_u32_batch_dispatch(in + begin, bits + begin / 64,
+                                      end - begin, M);
+    });
+  }
+
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+  // out[i] = in[i] % d given precomputed M
+  void fastmod_u64_batch(const uint64_t *in, uint64_t *out, size_t n,
+                         fastmod_u128_t M, uint64_t d) {
+    parallel_for(n, [=](size_t begin, size_t end) {
+      fastmod::fastmod_u64_batch(in + begin, out + begin, end - begin, M, d);
+    });
+  }
+
+  // out[i] = in[i] / d given precomputed M for d>1
+  void fastdiv_u64_batch(const uint64_t *in, uint64_t *out, size_t n,
+                         fastmod_u128_t M) {
+    parallel_for(n, [=](size_t begin, size_t end) {
+      fastmod::fastdiv_u64_batch(in + begin, out + begin, end - begin, M);
+    });
+  }
+#endif
+
+private:
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake; // a new job or stopping
+  std::condition_variable done; // pending reached zero
+  std::function<void(size_t, size_t)> job;
+  size_t job_n = 0;
+  size_t job_chunk = 0;
+  size_t pending = 0; // workers that have not finished the job
+  uint64_t generation = 0;
+  bool stopping = false;
+
+  void work(size_t t) {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      wake.wait(lock, [&]() { return stopping || generation != seen; });
+      if (stopping)
+        return;
+      seen = generation;
+      const size_t begin = t * job_chunk;
+      const size_t end = begin + job_chunk < job_n ? begin + job_chunk : job_n;
+      lock.unlock();
+      if (begin < end)
+        job(begin, end);
+      lock.lock();
+      if (--pending == 0)
+        done.notify_one();
+    }
+  }
+};
+
+} // fastmod
+
+#endif // FASTMOD_PARALLEL_H
@@ -0,0 +1,188 @@
+#ifndef FASTMOD_PARTITION_H
+#define FASTMOD_PARTITION_H
+
+#include "fastmod.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define FASTMOD_PARTITION_STREAM
+#endif
+
+namespace fastmod {
+
+/**
+ * Partitioning (the scatter of a hash join or of a shuffle) into any number
+ * of partitions (C++11).
+ * Usage:
+ *  fastmod::partitioner p(parts); // do once, parts should be non-zero
+ *  std::vector<size_t> offsets(parts + 1);
+ *  p.partition(hashes, values, n, out, offsets.data());
+ *  // the values of partition k are out[offsets[k]], ..., out[offsets[k+1]-1]
+ *  p.bucket(hash) // is hash % parts, the partition of a value
+ *
+ * The value values[i] goes to the partition fastmod_u32(hashes[i], M,
+ * parts) and the values of a partition keep their order; to partition
+ * 32-bit keys by themselves, pass the same array twice. There are two
+ * passes: a histogram gives the offset of each partition, then the values
+ * are scattered. Writing each value straight to its partition touches a
+ * new cache line (and often a new page) for almost every value once there
+ * are many partitions. Instead, the scatter may fill a 64-byte buffer per
+ * partition (software write combining), and these buffers are small
+ * enough to stay in the L1 or L2 cache; when one is full, the whole cache
+ * line is copied to the output at once, with non-temporal stores on x64
+ * when the output is larger than stream_threshold bytes.
+ *
+ * The buffers only pay off with the non-temporal stores and with at least
+ * min_buffered_parts partitions: with fewer partitions, the cache and the
+ * TLB absorb the direct stores. By default (automatic), partition picks
+ * the buffers in this case only; you can force either method. The values
+ * must be trivially copyable and, for the buffers, their size must divide
+ * 64 (e.g., 4, 8 or 16 bytes), otherwise they are scattered one at a time.
+ **/
+class partitioner {
+public:
+  // outputs larger than this (in bytes) bypass the cache
+  static const size_t stream_threshold = size_t(1) << 23;
+  // fewer partitions are scattered directly by default
+  static const uint32_t min_buffered_parts = 64;
+
+  enum scatter_method { automatic, direct, buffered };
+
+  explicit partitioner(uint32_t parts)
+      : d(parts), M(computeM_u32(parts)), lines(size_t(parts) * 64 + 64) {}
+
+  uint32_t parts() const { return d; }
+
+  uint32_t bucket(uint32_t hash) const { return fastmod_u32(hash, M, d); }
+
+  // offsets[k] is the number of hashes in the partitions before k, offsets
+  // must have room for parts() + 1 values
+  void histogram(const uint32_t *hashes, size_t n, size_t *offsets) const {
+    memset(offsets, 0, (size_t(d) + 1) * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) {
+      offsets[bucket(hashes[i]) + 1]++;
+    }
+    for (uint32_t k = 0; k < d; k++) {
+      offsets[k + 1] += offsets[k];
+    }
+  }
+
+  // out[offsets[k]], ..., out[offsets[k+1]-1] are the values of partition k
+  template <class T>
+  void partition(const uint32_t *hashes, const T *values, size_t n, T *out,
+                 size_t *offsets, scatter_method method = automatic) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "values must be trivially copyable");
+    histogram(hashes, n, offsets);
+    if (method == automatic) {
+#ifdef FASTMOD_PARTITION_STREAM
+      const bool stream = n * sizeof(T) > stream_threshold;
+#else
+      const bool stream = false;
+#endif
+      method = stream && d >= min_buffered_parts ? buffered : direct;
+    }
+    if (method == buffered && 64 % sizeof(T) == 0) {
+      scatter_buffered(hashes, values, n, out, offsets);
+    } else {
+      scatter_direct(hashes, values, n, out, offsets);
+    }
+  }
+
+private:
+  uint32_t d;
+  uint64_t M;
+  std::vector<uint8_t> lines; // one 64-byte line per partition, plus slack
+  std::vector<size_t> next;
+
+  template <class T>
+  void scatter_direct(const uint32_t *hashes, const T *values, size_t n,
+                      T *out, const size_t *offsets) {
+    next.assign(offsets, offsets + d);
+    for (size_t i = 0; i < n; i++) {
+      out[next[bucket(hashes[i])]++] = values[i];
+    }
+  }
+
+  // copies a full line to a 64-byte aligned destination
+  static void flush_line(uint8_t *dst, const uint8_t *line, bool stream) {
+#ifdef FASTMOD_PARTITION_STREAM
+    if (stream) {
+      const __m128i *src = reinterpret_cast<const __m128i *>(line);
+      __m128i *to = reinterpret_cast<__m128i *>(dst);
+      _mm_stream_si128(to, _mm_load_si128(src));
+      _mm_stream_si128(to + 1, _mm_load_si128(src + 1));
+      _mm_stream_si128(to + 2, _mm_load_si128(src + 2));
+      _mm_stream_si128(to + 3, _mm_load_si128(src + 3));
+      return;
+    }
+#else
+    (void)stream;
+#endif
+    memcpy(dst, line, 64);
+  }
+
+  // The output position p of partition k goes to the slot (p + skew) % L of
+  // line k, where skew aligns the slots with the cache lines of out. A line
+  // is copied whole when it is full, except for the first and the last line
+  // of a partition, which it may share with its neighbors.
+  template <class T>
+  void scatter_buffered(const uint32_t *hashes, const T *values, size_t n,
+                        T *out, const size_t *offsets) {
+    const size_t L = 64 / sizeof(T);
+    const size_t skew = (reinterpret_cast<uintptr_t>(out) % 64) / sizeof(T);
+    const bool aligned = reinterpret_cast<uintptr_t>(out) % sizeof(T) == 0;
+    const bool stream = aligned && n * sizeof(T) > stream_threshold;
+    const size_t padding =
+        (64 - reinterpret_cast<uintptr_t>(lines.data()) % 64) % 64;
+    uint8_t *buffers = lines.data() + padding;
+    uint8_t *bytes = reinterpret_cast<uint8_t *>(out);
+    next.assign(offsets, offsets + d);
+    for (size_t i = 0; i < n; i++) {
+      const uint32_t k = bucket(hashes[i]);
+      // the position counted from the start of the cache line of out[0]
+      const size_t q = next[k]++ + skew;
+      const size_t slot = q % L;
+      uint8_t *line = buffers + size_t(k) * 64;
+      memcpy(line + slot * sizeof(T), values + i, sizeof(T));
+      if (slot == L - 1) {
+        const size_t q0 = q + 1 - L; // the position of slot 0
+        const size_t begin = offsets[k] + skew;
+        if (aligned && q0 >= begin) {
+          flush_line(bytes + (q0 - skew) * sizeof(T), line, stream);
+        } else {
+          // the first line of the partition, or an unaligned output
+          const size_t from = q0 >= begin ? 0 : begin - q0;
+          memcpy(bytes + (q0 + from - skew) * sizeof(T),
+                 line + from * sizeof(T), (L - from) * sizeof(T));
+        }
+      }
+    }
+    // the last lines, which are not full
+    for (uint32_t k = 0; k < d; k++) {
+      const size_t q = next[k] + skew;
+      const size_t q0 = q - q % L;
+      const size_t begin = offsets[k] + skew;
+      const size_t from = q0 >= begin ? 0 : begin - q0;
+      if (q0 + from < q) {
+        memcpy(bytes + (q0 + from - skew) * sizeof(T),
+               buffers + size_t(k) * 64 + from * sizeof(T),
+               (q - q0 - from) * sizeof(T));
+      }
+    }
+#ifdef FASTMOD_PARTITION_STREAM
+    if (stream)
+      _mm_sfence(); // the non-temporal stores are visible to other threads
+#endif
+  }
+};
+
+} // fastmod
+
+#endif // FASTMOD_PARTITION_H
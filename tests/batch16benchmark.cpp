@@ -0,0 +1,177 @@
+#include "fastmod_batch.h"
+#include "performancecounters.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+template <typename T, typename F>
+uint64_t time(const F &x, const std::vector<T> &zomg, std::vector<T> &out) {
+  counters().start();
+  auto start = std::chrono::high_resolution_clock::now();
+  x(zomg.data(), out.data(), zomg.size());
+  doNotOptimizeAway(out.back());
+  auto end = std::chrono::high_resolution_clock::now();
+  event_count counts = counters().end();
+  auto diff = end - start;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
+  std::fprintf(stderr, "Time: %zu\n", size_t(ns));
+  print_counters(counts, zomg.size());
+  return ns;
+}
+
+void bench16(uint16_t mod, const std::vector<uint16_t> &zomg,
+             std::vector<uint16_t> &out) {
+  std::cout << "== 16-bit divisor " << mod << std::endl;
+  const uint32_t M = computeM_u16(mod);
+  std::cout << "timing fastmod_u16 (one at a time)" << std::endl;
+  auto fmtime = time(
+      [M, mod](const uint16_t *in, uint16_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = fastmod_u16(in[i], M, mod);
+        }
+      },
+      zomg, out);
+  std::cout << "timing fastmod_u16_batch" << std::endl;
+  auto fmbtime = time(
+      [M, mod](const uint16_t *in, uint16_t *o, size_t n) {
+        fastmod_u16_batch(in, o, n, M, mod);
+      },
+      zomg, out);
+  std::cout << "timing x modulo mod; " << std::endl;
+  auto modtime = time(
+      [mod](const uint16_t *in, uint16_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = in[i] % mod;
+        }
+      },
+      zomg, out);
+  std::fprintf(stderr,
+               "fastmod_u16_batch is %lf as fast as fastmod_u16 and %lf as "
+               "fast as modding\n",
+               (double)fmtime / fmbtime, (double)modtime / fmbtime);
+
+  std::cout << "timing fastdiv_u16 (one at a time)" << std::endl;
+  auto fdtime = time(
+      [M](const uint16_t *in, uint16_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = fastdiv_u16(in[i], M);
+        }
+      },
+      zomg, out);
+  std::cout << "timing fastdiv_u16_batch" << std::endl;
+  auto fdbtime = time(
+      [M](const uint16_t *in, uint16_t *o, size_t n) {
+        fastdiv_u16_batch(in, o, n, M);
+      },
+      zomg, out);
+  std::cout << "timing x divided by mod; " << std::endl;
+  auto divtime = time(
+      [mod](const uint16_t *in, uint16_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = in[i] / mod;
+        }
+      },
+      zomg, out);
+  std::fprintf(stderr,
+               "fastdiv_u16_batch is %lf as fast as fastdiv_u16 and %lf as "
+               "fast as dividing\n",
+               (double)fdtime / fdbtime, (double)divtime / fdbtime);
+}
+
+void bench8(uint8_t mod, const std::vector<uint8_t> &zomg,
+            std::vector<uint8_t> &out) {
+  std::cout << "== 8-bit divisor " << unsigned(mod) << std::endl;
+  const uint16_t M = computeM_u8(mod);
+  std::cout << "timing fastmod_u8 (one at a time)" << std::endl;
+  auto fmtime = time(
+      [M, mod](const uint8_t *in, uint8_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = fastmod_u8(in[i], M, mod);
+        }
+      },
+      zomg, out);
+  std::cout << "timing fastmod_u8_batch" << std::endl;
+  auto fmbtime = time(
+      [M, mod](const uint8_t *in, uint8_t *o, size_t n) {
+        fastmod_u8_batch(in, o, n, M, mod);
+      },
+      zomg, out);
+  std::cout << "timing x modulo mod; " << std::endl;
+  auto modtime = time(
+      [mod](const uint8_t *in, uint8_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = in[i] % mod;
+        }
+      },
+      zomg, out);
+  std::fprintf(stderr,
+               "fastmod_u8_batch is %lf as fast as fastmod_u8 and %lf as "
+               "fast as modding\n",
+               (double)fmtime / fmbtime, (double)modtime / fmbtime);
+
+  std::cout << "timing fastdiv_u8 (one at a time)" << std::endl;
+  auto fdtime = time(
+      [M](const uint8_t *in, uint8_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = fastdiv_u8(in[i], M);
+        }
+      },
+      zomg, out);
+  std::cout << "timing fastdiv_u8_batch" << std::endl;
+  auto fdbtime = time(
+      [M](const uint8_t *in, uint8_t *o, size_t n) {
+        fastdiv_u8_batch(in, o, n, M);
+      },
+      zomg, out);
+  std::cout << "timing x divided by mod; " << std::endl;
+  auto divtime = time(
+      [mod](const uint8_t *in, uint8_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = in[i] / mod;
+        }
+      },
+      zomg, out);
+  std::fprintf(stderr,
+               "fastdiv_u8_batch is %lf as fast as fastdiv_u8 and %lf as "
+               "fast as dividing\n",
+               (double)fdtime / fdbtime, (double)divtime / fdbtime);
+}
+
+int main() {
+  std::mt19937_64 mt;
+  std::vector<uint16_t> zomg16(10000000);
+  for (auto &e : zomg16)
+    e = uint16_t(mt());
+  std::vector<uint16_t> out16(zomg16.size());
+  bench16(uint16_t(mt() % 0xFFFE + 2), zomg16, out16);
+  std::vector<uint8_t> zomg8(10000000);
+  for (auto &e : zomg8)
+    e = uint8_t(mt());
+  std::vector<uint8_t> out8(zomg8.size());
+  bench8(uint8_t(mt() % 0xFE + 2), zomg8, out8);
+}
@@ -0,0 +1,117 @@
+#include "fastmod_batch.h"
+#include "performancecounters.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+template <typename F>
+uint64_t time(const F &x, const std::vector<uint64_t> &zomg,
+              std::vector<uint64_t> &out) {
+  counters().start();
+  auto start = std::chrono::high_resolution_clock::now();
+  x(zomg.data(), out.data(), zomg.size());
+  doNotOptimizeAway(out.back());
+  auto end = std::chrono::high_resolution_clock::now();
+  event_count counts = counters().end();
+  auto diff = end - start;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
+  std::fprintf(stderr, "Time: %zu\n", size_t(ns));
+  print_counters(counts, zomg.size());
+  return ns;
+}
+
+void bench(uint64_t mod, const std::vector<uint64_t> &zomg,
+           std::vector<uint64_t> &out) {
+  std::cout << "== divisor " << mod << std::endl;
+  const auto M = computeM_u64(mod);
+  std::cout << "timing fastmod_u64 (one at a time)" << std::endl;
+  auto fmtime = time(
+      [M, mod](const uint64_t *in, uint64_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = fastmod_u64(in[i], M, mod);
+        }
+      },
+      zomg, out);
+  std::cout << "timing fastmod_u64_batch" << std::endl;
+  auto fmbtime = time(
+      [M, mod](const uint64_t *in, uint64_t *o, size_t n) {
+        fastmod_u64_batch(in, o, n, M, mod);
+      },
+      zomg, out);
+  std::cout << "timing x modulo mod; " << std::endl;
+  auto modtime = time(
+      [mod](const uint64_t *in, uint64_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = in[i] % mod;
+        }
+      },
+      zomg, out);
+  std::fprintf(stderr,
+               "fastmod_u64_batch is %lf as fast as fastmod_u64 and %lf as "
+               "fast as modding\n",
+               (double)fmtime / fmbtime, (double)modtime / fmbtime);
+
+  std::cout << "timing fastdiv_u64 (one at a time)" << std::endl;
+  auto fdtime = time(
+      [M](const uint64_t *in, uint64_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = fastdiv_u64(in[i], M);
+        }
+      },
+      zomg, out);
+  std::cout << "timing fastdiv_u64_batch" << std::endl;
+  auto fdbtime = time(
+      [M](const uint64_t *in, uint64_t *o, size_t n) {
+        fastdiv_u64_batch(in, o, n, M);
+      },
+      zomg, out);
+  std::cout << "timing x divided by mod; " << std::endl;
+  auto divtime = time(
+      [mod](const uint64_t *in, uint64_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = in[i] / mod;
+        }
+      },
+      zomg, out);
+  std::fprintf(stderr,
+               "fastdiv_u64_batch is %lf as fast as fastdiv_u64 and %lf as "
+               "fast as dividing\n",
+               (double)fdtime / fdbtime, (double)divtime / fdbtime);
+}
+
+int main() {
+  std::mt19937_64 mt;
+  std::vector<uint64_t> zomg(10000000);
+  for (auto &e : zomg)
+    e = mt();
+  std::vector<uint64_t> out(zomg.size());
+  // native division gets slower as the quotient gets larger on many
+  // processors, so we try both a small and a large divisor
+  bench(mt() % (1 << 27), zomg, out);
+  bench(mt() >> 8, zomg, out);
+}
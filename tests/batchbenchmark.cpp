@@ -0,0 +1,152 @@
+#include "fastmod_dispatch.h"
+#include "performancecounters.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+template <typename F>
+uint64_t time(const F &x, const std::vector<uint32_t> &zomg,
+              std::vector<uint32_t> &out) {
+  counters().start();
+  auto start = std::chrono::high_resolution_clock::now();
+  x(zomg.data(), out.data(), zomg.size());
+  doNotOptimizeAway(out.back());
+  auto end = std::chrono::high_resolution_clock::now();
+  event_count counts = counters().end();
+  auto diff = end - start;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
+  std::fprintf(stderr, "Time: %zu\n", size_t(ns));
+  print_counters(counts, zomg.size());
+  return ns;
+}
+
+int main() {
+  std::mt19937_64 mt;
+  uint32_t mod = uint32_t(mt() % (1 << 27));
+  std::vector<uint32_t> zomg(10000000);
+  for (auto &e : zomg)
+    e = uint32_t(mt());
+  std::vector<uint32_t> out(zomg.size());
+
+  const uint64_t M = computeM_u32(mod);
+  std::cout << "timing fastmod_u32 (one at a time)" << std::endl;
+  auto fmtime = time(
+      [M, mod](const uint32_t *in, uint32_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = fastmod_u32(in[i], M, mod);
+        }
+      },
+      zomg, out);
+  std::cout << "timing fastmod_u32_batch" << std::endl;
+  auto fmbtime = time(
+      [M, mod](const uint32_t *in, uint32_t *o, size_t n) {
+        fastmod_u32_batch(in, o, n, M, mod);
+      },
+      zomg, out);
+  std::cout << "timing fastmod_u32_batch_portable" << std::endl;
+  auto fmptime = time(
+      [M, mod](const uint32_t *in, uint32_t *o, size_t n) {
+        fastmod_u32_batch_portable(in, o, n, M, mod);
+      },
+      zomg, out);
+  std::cout << "timing fastmod_u32_batch_dispatch ("
+            << fastmod_dispatch_name() << ")" << std::endl;
+  auto fmdtime = time(
+      [M, mod](const uint32_t *in, uint32_t *o, size_t n) {
+        fastmod_u32_batch_dispatch(in, o, n, M, mod);
+      },
+      zomg, out);
+  std::cout << "timing x modulo mod; " << std::endl;
+  auto modtime = time(
+      [mod](const uint32_t *in, uint32_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = in[i] % mod;
+        }
+      },
+      zomg, out);
+  std::fprintf(stderr,
+               "fastmod_u32_batch is %lf as fast as fastmod_u32 and %lf as "
+               "fast as modding\n",
+               (double)fmtime / fmbtime, (double)modtime / fmbtime);
+  std::fprintf(stderr,
+               "fastmod_u32_batch_portable is %lf as fast as fastmod_u32 and "
+               "%lf as fast as modding\n",
+               (double)fmtime / fmptime, (double)modtime / fmptime);
+  std::fprintf(stderr,
+               "fastmod_u32_batch_dispatch is %lf as fast as fastmod_u32 and "
+               "%lf as fast as modding\n",
+               (double)fmtime / fmdtime, (double)modtime / fmdtime);
+
+  std::cout << "timing fastdiv_u32 (one at a time)" << std::endl;
+  auto fdtime = time(
+      [M](const uint32_t *in, uint32_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = fastdiv_u32(in[i], M);
+        }
+      },
+      zomg, out);
+  std::cout << "timing fastdiv_u32_batch" << std::endl;
+  auto fdbtime = time(
+      [M](const uint32_t *in, uint32_t *o, size_t n) {
+        fastdiv_u32_batch(in, o, n, M);
+      },
+      zomg, out);
+  std::cout << "timing fastdiv_u32_batch_portable" << std::endl;
+  auto fdptime = time(
+      [M](const uint32_t *in, uint32_t *o, size_t n) {
+        fastdiv_u32_batch_portable(in, o, n, M);
+      },
+      zomg, out);
+  std::cout << "timing fastdiv_u32_batch_dispatch ("
+            << fastmod_dispatch_name() << ")" << std::endl;
+  auto fddtime = time(
+      [M](const uint32_t *in, uint32_t *o, size_t n) {
+        fastdiv_u32_batch_dispatch(in, o, n, M);
+      },
+      zomg, out);
+  std::cout << "timing x divided by mod; " << std::endl;
+  auto divtime = time(
+      [mod](const uint32_t *in, uint32_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          o[i] = in[i] / mod;
+        }
+      },
+      zomg, out);
+  std::fprintf(stderr,
+               "fastdiv_u32_batch is %lf as fast as fastdiv_u32 and %lf as "
+               "fast as dividing\n",
+               (double)fdtime / fdbtime, (double)divtime / fdbtime);
+  std::fprintf(stderr,
+               "fastdiv_u32_batch_portable is %lf as fast as fastdiv_u32 and "
+               "%lf as fast as dividing\n",
+               (double)fdtime / fdptime, (double)divtime / fdptime);
+  std::fprintf(stderr,
+               "fastdiv_u32_batch_dispatch is %lf as fast as fastdiv_u32 and "
+               "%lf as fast as dividing\n",
+               (double)fdtime / fddtime, (double)divtime / fddtime);
+}
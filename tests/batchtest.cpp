@@ -0,0 +1,112 @@
+// Tests of the portable batch kernels. The build defines
+// FASTMOD_BATCH_PORTABLE so that fastmod_u32_batch and fastdiv_u32_batch
+// select them unless the compiler targets SSE4.1 or better.
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "fastmod_batch.h"
+
+using namespace fastmod;
+
+static bool check(const char *name, const std::vector<uint32_t> &in,
+                  const std::vector<uint32_t> &out, uint32_t d, bool mod) {
+  for (size_t i = 0; i < in.size(); i++) {
+    const uint32_t expected = mod ? in[i] % d : in[i] / d;
+    if (out[i] != expected) {
+      printf("(bad %s) problem with divisor %" PRIu32 " and dividend %" PRIu32
+             "\n",
+             name, d, in[i]);
+      printf("expected %" PRIu32 ", got %" PRIu32 "\n", expected, out[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+// the divisors around the powers of two and pseudo-random ones
+static std::vector<uint32_t> divisors() {
+  std::vector<uint32_t> d;
+  for (int k = 0; k < 32; k++) {
+    const uint32_t p = uint32_t(1) << k;
+    d.push_back(p);
+    d.push_back(p + 1);
+    if (p > 2)
+      d.push_back(p - 1);
+  }
+  d.push_back(UINT32_MAX);
+  uint64_t x = UINT64_C(0x9E3779B97F4A7C15);
+  for (int i = 0; i < 1000; i++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    const uint32_t r = uint32_t(x >> (x % 32 + 32)); // all magnitudes
+    if (r != 0)
+      d.push_back(r);
+  }
+  return d;
+}
+
+bool testportable(bool verbose) {
+  // an odd length leaves a tail to the end of the vectorized loops
+  const size_t n = 1003;
+  std::vector<uint32_t> in(n), out(n);
+  uint64_t x = UINT64_C(0xC2B2AE3D27D4EB4F);
+  for (size_t i = 0; i < n; i++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    in[i] = uint32_t(x >> 32);
+  }
+  in[0] = 0;
+  in[1] = 1;
+  in[2] = UINT32_MAX;
+  in[3] = UINT32_MAX - 1;
+  const std::vector<uint32_t> all = divisors();
+  for (uint32_t d : all) {
+    const uint64_t M = computeM_u32(d);
+    in[4] = d;
+    in[5] = d - 1;
+    fastmod_u32_batch_portable(in.data(), out.data(), n, M, d);
+    if (!check("fastmod_u32_batch_portable", in, out, d, true))
+      return false;
+    fastmod_u32_batch(in.data(), out.data(), n, M, d);
+    if (!check("fastmod_u32_batch", in, out, d, true))
+      return false;
+    if (d == 1)
+      continue; // fastdiv does not support d = 1
+    fastdiv_u32_batch_portable(in.data(), out.data(), n, M);
+    if (!check("fastdiv_u32_batch_portable", in, out, d, false))
+      return false;
+    fastdiv_u32_batch(in.data(), out.data(), n, M);
+    if (!check("fastdiv_u32_batch", in, out, d, false))
+      return false;
+  }
+  if (verbose)
+    printf("portable batch test passed with %zu divisors.\n", all.size());
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  bool isok = true;
+  bool verbose = false;
+  for (int i = 0; i < argc; ++i) {
+    if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+      verbose = true;
+      break;
+    }
+  }
+#ifndef FASTMOD_BATCH_PORTABLE
+  printf("FASTMOD_BATCH_PORTABLE is not defined.\n");
+  isok = false;
+#endif
+  isok = isok && testportable(verbose);
+  if (isok) {
+    printf("Code looks good.\n");
+    return 0;
+  } else {
+    printf("You have some failing tests.\n");
+    return -1;
+  }
+}
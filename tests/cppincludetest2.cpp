@@ -113,8 +113,9 @@ bool testdivunsigned(uint32_t min, uint32_t max, bool verbose) {
 bool testsigned(int32_t min, int32_t max, bool verbose) {
   printf("\n==Testing testsigned with min = %d and max = %d\n", min, max);
   size_t count = 0;
-  assert(min != max + 1); // infinite loop!
-  for (int32_t d = min; (d <= max) && (d >= min); d++) {
+  // d++ would overflow at INT32_MAX, the counter has 64 bits
+  for (int64_t d64 = min; d64 <= max; d64++) {
+    const int32_t d = (int32_t)d64;
     if (d == 0) {
       printf("skipping d = 0 as it cannot be supported\n");
       continue;
@@ -164,10 +165,11 @@ bool testsigned(int32_t min, int32_t max, bool verbose) {
 
 bool testdivsigned(int32_t min, int32_t max, bool verbose) {
   printf("\n==Testing divsigned with min = %d and max = %d\n", min, max);
-  assert(min != max + 1); // infinite loop!
   size_t count = 0;
   static_assert(int32_t(INT32_MIN) < int32_t(2147483647));
-  for (int32_t d = min; (d <= max) && (d >= min); d++) {
+  // d++ would overflow at INT32_MAX, the counter has 64 bits
+  for (int64_t d64 = min; d64 <= max; d64++) {
+    const int32_t d = (int32_t)d64;
     if (d == 0) {
       printf("skipping d = 0\n");
       continue;
@@ -224,6 +226,20 @@ bool testdivsigned(int32_t min, int32_t max, bool verbose) {
   return true;
 }
 
+// all 32-bit divisors
+bool testcomputeM(bool verbose) {
+  uint32_t d = 1;
+  do {
+    if (computeM_u32_nodiv(d) != computeM_u32(d)) {
+      printf("(bad computeM_u32_nodiv) problem with divisor %u\n", d);
+      return false;
+    }
+  } while (++d != 0);
+  if (verbose)
+    printf("computeM_u32_nodiv test passed with all divisors.\n");
+  return true;
+}
+
 int main(int argc, char *argv[]) {
   bool isok = true;
   bool verbose = false;
@@ -234,6 +250,7 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  isok = isok && testcomputeM(verbose);
   isok = isok && testdivsigned(0x7ffffff8, 0x7fffffff, verbose);
   isok = isok && testdivsigned(INT32_MIN, -0x7ffffff8, verbose);
   isok = isok && testdivsigned(2, 10, verbose);
@@ -0,0 +1,252 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "fastmod.h"
+
+using namespace fastmod;
+
+template <typename T> std::vector<T> dividends(T d) {
+  std::vector<T> values;
+  // computed with unsigned integers, which wrap around
+  const uint64_t u = uint64_t(d);
+  const T specials[] = {0, 1, 2, 3, T(u - 1), d, T(u + 1), T(2 * u),
+                        T(-1), T(-2), T(0 - u), T(0 - u - 1), T(1 - u)};
+  for (T v : specials) {
+    values.push_back(v);
+  }
+  uint64_t x = 1234567;
+  for (int i = 0; i < 1000; i++) {
+    x = x * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+    values.push_back(T(x >> (i % 64)));
+  }
+  return values;
+}
+
+template <typename T> bool testdivisor(T d, bool verbose) {
+  divisor<T> div(d);
+  if (div.value() != d) {
+    printf("bad divisor value\n");
+    return false;
+  }
+  for (T a : dividends<T>(d)) {
+    if (T(-1) < T(0) && d == T(-1) && a == T(T(1) << (8 * sizeof(T) - 1))) {
+      continue; // undefined
+    }
+    T q = a / d;
+    T r = a % d;
+    divmod_result<T> qr = div.divmod(a);
+    T a_mod = a;
+    a_mod %= div;
+    T a_div = a;
+    a_div /= div;
+    if ((a / div != q) || (a % div != r) || (qr.quotient != q) ||
+        (qr.remainder != r) || (a_mod != r) || (a_div != q) ||
+        (div.divides(a) != (r == 0))) {
+      printf("(bad divisor) problem with divisor %" PRId64
+             " and dividend %" PRId64 " \n",
+             int64_t(d), int64_t(a));
+      printf("expected %" PRId64 " %" PRId64 "\n", int64_t(q), int64_t(r));
+      printf("got %" PRId64 " %" PRId64 "\n", int64_t(a / div),
+             int64_t(a % div));
+      return false;
+    }
+  }
+  if (verbose)
+    printf("divisor %" PRId64 " ok!\n", int64_t(d));
+  return true;
+}
+
+template <typename T> bool testdivisors(T min, T max, bool verbose) {
+  for (T d = min; (d <= max) && (d >= min); d++) {
+    if (d == 0) {
+      continue;
+    }
+    if (!testdivisor<T>(d, verbose)) {
+      return false;
+    }
+    if (d == max) {
+      break;
+    }
+  }
+  return true;
+}
+
+template <typename T, size_t N>
+bool testmixedradix(const T (&extents)[N], bool verbose) {
+  mixed_radix<N, T> radix(extents);
+  std::vector<T> indices = dividends<T>(extents[N - 1]);
+  std::vector<T> out(N * indices.size());
+  radix.decode_batch(indices.data(), out.data(), indices.size());
+  for (size_t i = 0; i < indices.size(); i++) {
+    T coords[N];
+    radix.decode(indices[i], coords);
+    T rest = indices[i];
+    for (size_t k = N - 1; k > 0; k--) {
+      T expected = rest % extents[k];
+      rest /= extents[k];
+      if ((coords[k] != expected) || (out[N * i + k] != expected)) {
+        printf("(bad mixed_radix) problem with extent %" PRIu64
+               " and index %" PRIu64 " \n",
+               uint64_t(extents[k]), uint64_t(indices[i]));
+        return false;
+      }
+    }
+    if ((coords[0] != rest) || (out[N * i] != rest) ||
+        (radix.encode(coords) != indices[i])) {
+      printf("(bad mixed_radix) problem with index %" PRIu64 " \n",
+             uint64_t(indices[i]));
+      return false;
+    }
+  }
+  if (verbose)
+    printf("mixed_radix with %zu extents ok!\n", N);
+  return true;
+}
+
+// checks fastmod<d> and fastdiv<d> for each d
+template <typename T> bool testtemplates(bool) { return true; }
+
+template <typename T, T d, T... rest> bool testtemplates(bool verbose) {
+  for (T a : dividends<T>(d)) {
+    if (T(-1) < T(0) && d == T(-1) && a == T(T(1) << (8 * sizeof(T) - 1))) {
+      continue; // undefined
+    }
+    if (fastmod::fastmod<d>(a) != T(a % d) ||
+        fastmod::fastdiv<d>(a) != T(a / d)) {
+      printf("(bad fastmod<d>) divisor %" PRId64 " (%zu bytes), dividend "
+             "%" PRId64 "\n",
+             int64_t(d), sizeof(T), int64_t(a));
+      return false;
+    }
+  }
+  if (verbose)
+    printf("fastmod<%" PRId64 "> with %zu bytes ok!\n", int64_t(d), sizeof(T));
+  return testtemplates<T, rest...>(verbose);
+}
+
+#if __cpp_constexpr >= 201304 && !defined(_MSC_VER)
+static_assert(uint32_t(17) % divisor<uint32_t>(5) == 2, "constexpr mod");
+static_assert(uint32_t(17) / divisor<uint32_t>(5) == 3, "constexpr div");
+static_assert(int32_t(-17) % divisor<int32_t>(-5) == -2, "constexpr mod");
+static_assert(int32_t(-17) / divisor<int32_t>(-5) == 3, "constexpr div");
+// the magic number, the mask or shift, and the comparison
+static_assert(fastmod::fastmod<7>(uint32_t(100)) == 2, "constexpr mod");
+static_assert(fastmod::fastdiv<7>(uint32_t(100)) == 14, "constexpr div");
+static_assert(fastmod::fastmod<1>(uint32_t(100)) == 0, "constexpr mod");
+static_assert(fastmod::fastdiv<1>(uint32_t(100)) == 100, "constexpr div");
+static_assert(fastmod::fastmod<64>(uint32_t(100)) == 36, "constexpr mod");
+static_assert(fastmod::fastdiv<64>(uint32_t(100)) == 1, "constexpr div");
+static_assert(fastmod::fastmod<4294967291u>(uint32_t(4294967295u)) == 4,
+              "constexpr mod");
+static_assert(fastmod::fastdiv<4294967291u>(uint32_t(4294967295u)) == 1,
+              "constexpr div");
+static_assert(fastmod::fastmod<-7>(int32_t(-100)) == -2, "constexpr mod");
+static_assert(fastmod::fastdiv<-7>(int32_t(-100)) == 14, "constexpr div");
+static_assert(fastmod::fastmod<-64>(int32_t(-100)) == -36, "constexpr mod");
+static_assert(fastmod::fastdiv<-64>(int32_t(-100)) == 1, "constexpr div");
+static_assert(fastmod::fastdiv<-1>(int32_t(-100)) == 100, "constexpr div");
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+static_assert(fastmod::fastmod<1000003>(UINT64_C(1) << 40) == 329252,
+              "constexpr mod");
+static_assert(fastmod::fastdiv<1000003>(UINT64_C(1) << 40) == 1099508,
+              "constexpr div");
+static_assert(fastmod::fastmod<UINT64_C(1) << 40>(~UINT64_C(0)) ==
+                  (UINT64_C(1) << 40) - 1,
+              "constexpr mod");
+static_assert(fastmod::fastdiv<UINT64_C(1) << 40>(~UINT64_C(0)) ==
+                  (UINT64_C(1) << 24) - 1,
+              "constexpr div");
+static_assert(fastmod::fastmod<UINT64_C(18446744073709551557)>(~UINT64_C(0)) ==
+                  58,
+              "constexpr mod");
+static_assert(fastmod::fastdiv<UINT64_C(18446744073709551557)>(~UINT64_C(0)) ==
+                  1,
+              "constexpr div");
+static_assert(fastmod::fastmod<INT64_C(-1000003)>(-(INT64_C(1) << 40)) ==
+                  -329252,
+              "constexpr mod");
+static_assert(fastmod::fastdiv<INT64_C(-1000003)>(-(INT64_C(1) << 40)) ==
+                  1099508,
+              "constexpr div");
+static_assert(fastmod::fastmod<INT64_C(1) << 40>(INT64_MIN + 1) ==
+                  -((INT64_C(1) << 40) - 1),
+              "constexpr mod");
+static_assert(fastmod::fastdiv<-(INT64_C(1) << 40)>(INT64_MIN) ==
+                  (INT64_C(1) << 23),
+              "constexpr div");
+#endif
+#endif
+
+int main(int argc, char *argv[]) {
+  bool isok = true;
+  bool verbose = false;
+  for (int i = 0; i < argc; ++i) {
+    if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+      verbose = true;
+      break;
+    }
+  }
+  isok = isok && testdivisors<uint32_t>(1, 1000, verbose);
+  isok = isok && testdivisors<uint32_t>(0xfffffc00, 0xffffffff, verbose);
+  isok = isok && testdivisors<int32_t>(-1000, 1000, verbose);
+  isok = isok && testdivisors<int32_t>(0x7ffffc00, 0x7fffffff, verbose);
+  isok = isok && testdivisors<int32_t>(INT32_MIN + 1, INT32_MIN + 1000, verbose);
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+  isok = isok && testdivisors<uint64_t>(1, 1000, verbose);
+  isok = isok && testdivisors<uint64_t>(UINT64_C(0xfffffffffffffc00),
+                                        UINT64_C(0xffffffffffffffff), verbose);
+  isok = isok && testdivisors<int64_t>(-1000, 1000, verbose);
+  isok = isok && testdivisors<int64_t>(INT64_MAX - 1000, INT64_MAX, verbose);
+  isok = isok && testdivisors<int64_t>(INT64_MIN + 1, INT64_MIN + 1000, verbose);
+#endif
+  isok = isok && testtemplates<uint32_t, 1, 2, 3, 7, 10, 1024, 1000003,
+                               0x80000000, 0x80000001, 4294967291u,
+                               0xffffffff>(verbose);
+  isok = isok && testtemplates<int32_t, 1, -1, 2, -2, 7, -7, 1024, -1024,
+                               1000003, -1000003, 0x40000000, -0x40000000,
+                               INT32_MAX, INT32_MIN + 1>(verbose);
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+  isok = isok && testtemplates<uint64_t, 1, 2, 3, 7, 1024, 1000003,
+                               UINT64_C(1) << 32, UINT64_C(0x100000001),
+                               UINT64_C(1) << 63, (UINT64_C(1) << 63) + 1,
+                               UINT64_C(18446744073709551557),
+                               UINT64_MAX>(verbose);
+  isok = isok && testtemplates<int64_t, 1, -1, 2, -2, 7, -7, 1024, -1024,
+                               INT64_C(1) << 40, -(INT64_C(1) << 40),
+                               INT64_C(1) << 62, -(INT64_C(1) << 62),
+                               INT64_MAX, INT64_MIN + 1>(verbose);
+#endif
+  const uint32_t shape[4] = {7, 1, 640, 3};
+  const uint32_t clock[4] = {1, 24, 60, 60};
+  const uint32_t big[2] = {0xfffffffb, 0xffffffff};
+  const uint32_t single[1] = {5};
+  isok = isok && testmixedradix(shape, verbose);
+  isok = isok && testmixedradix(clock, verbose);
+  isok = isok && testmixedradix(big, verbose);
+  isok = isok && testmixedradix(single, verbose);
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+  const uint64_t shape64[5] = {UINT64_C(1) << 40, 1, UINT64_C(100000007),
+                               17, UINT64_C(0xfffffffffffffff1)};
+  isok = isok && testmixedradix(shape64, verbose);
+#endif
+  for (int k = 0; k < 1000; k++) {
+    uint32_t x = uint32_t(rand()) * 2 + 1;
+    isok = isok && testdivisor<uint32_t>(x, verbose);
+    isok = isok && testdivisor<int32_t>(int32_t(x), verbose);
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+    isok = isok && testdivisor<uint64_t>(uint64_t(x) << (k % 32), verbose);
+    isok = isok && testdivisor<int64_t>(-int64_t(uint64_t(x) << (k % 32)),
+                                        verbose);
+#endif
+  }
+  if (isok) {
+    printf("Code looks good.\n");
+    return 0;
+  } else {
+    printf("You have some failing tests.\n");
+    return -1;
+  }
+}
@@ -0,0 +1,232 @@
+// Hashing benchmark behind docs/hashbenches-skylake-clang.png.
+//
+// Usage: hashbenchmark [chart | string | integer] [--size bytes]
+//
+// Each workload prints a CSV block to stdout:
+//   workload,divisor,division_instruction,compiler,fastmod,fastmod_const
+// where the last four columns are the running times in seconds of
+//   division_instruction  the % operator with a divisor that the compiler
+//                         does not know (a hardware division),
+//   compiler              the % operator with a constant divisor,
+//   fastmod               fastmod_u32 with a precomputed M,
+//   fastmod_const         the fastmod<d> template.
+//
+// The chart workload is the one in the README: a string is hashed one byte
+// at a time with h = (31 * h + c) % d for each divisor from 3 to 64, so that
+// every step waits on a remainder. docs/hashbenches.gnuplot redraws the chart
+// from its output:
+//   ./hashbenchmark chart --size 100000000 > hashbenches.csv
+//   gnuplot docs/hashbenches.gnuplot
+//
+// The string and integer workloads fill the histogram of a table whose size
+// is a prime from hash_primes (fastmod_hashmap.h): many short strings (or
+// integer keys) are hashed and each hash value is reduced to a slot.
+#include "fastmod_hashmap.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+
+// hides a value from the optimizer so that the divisor is only known at
+// runtime
+template <typename T> T opaque(T x) {
+  volatile T v = x;
+  return v;
+}
+
+template <typename F> double seconds(const F &x) {
+  auto start = std::chrono::high_resolution_clock::now();
+  x();
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+struct row {
+  double division_instruction, compiler, fastmod, fastmod_const;
+};
+
+void print_row(const char *workload, uint32_t d, const row &r) {
+  std::printf("%s,%u,%.6f,%.6f,%.6f,%.6f\n", workload, d,
+              r.division_instruction, r.compiler, r.fastmod, r.fastmod_const);
+  std::fflush(stdout);
+}
+
+// h = (31 * h + c) % d for each byte c, where reduce(x) is x % d
+template <typename F>
+uint32_t hash_chain(const std::vector<uint8_t> &text, F reduce) {
+  uint32_t h = 0;
+  for (uint8_t c : text) {
+    h = reduce(31 * h + c);
+  }
+  return h;
+}
+
+template <uint32_t d> row chart_divisor(const std::vector<uint8_t> &text) {
+  const uint32_t rd = opaque(d);
+  const uint64_t M = computeM_u32(rd);
+  row r;
+  r.division_instruction = seconds([&]() {
+    doNotOptimizeAway(hash_chain(text, [rd](uint32_t x) { return x % rd; }));
+  });
+  r.compiler = seconds([&]() {
+    doNotOptimizeAway(hash_chain(text, [](uint32_t x) { return x % d; }));
+  });
+  r.fastmod = seconds([&]() {
+    doNotOptimizeAway(
+        hash_chain(text, [M, rd](uint32_t x) { return fastmod_u32(x, M, rd); }));
+  });
+  r.fastmod_const = seconds([&]() {
+    doNotOptimizeAway(
+        hash_chain(text, [](uint32_t x) { return fastmod::fastmod<d>(x); }));
+  });
+  return r;
+}
+
+// instantiates chart_divisor<d> for d = first, ..., last
+template <uint32_t first, uint32_t last> struct chart_sweep {
+  static void run(const std::vector<uint8_t> &text) {
+    print_row("chart", first, chart_divisor<first>(text));
+    chart_sweep<first + 1, last>::run(text);
+  }
+};
+template <uint32_t last> struct chart_sweep<last, last> {
+  static void run(const std::vector<uint8_t> &text) {
+    print_row("chart", last, chart_divisor<last>(text));
+  }
+};
+
+// the string hash of Java, words are separated by zeros
+std::vector<uint32_t> word_hashes(const std::vector<uint8_t> &text) {
+  std::vector<uint32_t> hashes;
+  uint32_t h = 0;
+  for (uint8_t c : text) {
+    if (c == 0) {
+      hashes.push_back(h);
+      h = 0;
+    } else {
+      h = 31 * h + c;
+    }
+  }
+  return hashes;
+}
+
+// murmur3's finalizer, so that consecutive keys are spread over the table
+inline uint32_t hash_integer(uint64_t key) {
+  key ^= key >> 33;
+  key *= UINT64_C(0xff51afd7ed558ccd);
+  key ^= key >> 33;
+  return uint32_t(key ^ (key >> 32));
+}
+
+// counts[reduce(hash(key))]++ for every key
+template <typename K, typename H, typename F>
+void fill(const std::vector<K> &keys, std::vector<uint32_t> &counts, H hash,
+          F reduce) {
+  for (const K &k : keys) {
+    counts[reduce(hash(k))]++;
+  }
+  doNotOptimizeAway(counts.back());
+}
+
+template <size_t index, typename K, typename H>
+row table(const std::vector<K> &keys, H hash) {
+  constexpr uint32_t d = hash_primes[index].prime;
+  const uint32_t rd = opaque(d);
+  const uint64_t M = computeM_u32(rd);
+  std::vector<uint32_t> counts(d);
+  row r;
+  r.division_instruction = seconds([&]() {
+    fill(keys, counts, hash, [rd](uint32_t x) { return x % rd; });
+  });
+  r.compiler = seconds(
+      [&]() { fill(keys, counts, hash, [](uint32_t x) { return x % d; }); });
+  r.fastmod = seconds([&]() {
+    fill(keys, counts, hash,
+         [M, rd](uint32_t x) { return fastmod_u32(x, M, rd); });
+  });
+  r.fastmod_const = seconds([&]() {
+    fill(keys, counts, hash,
+         [](uint32_t x) { return fastmod::fastmod<d>(x); });
+  });
+  return r;
+}
+
+// small, medium and large tables
+template <typename K, typename H>
+void tables(const char *workload, const std::vector<K> &keys, H hash) {
+  print_row(workload, hash_primes[7].prime, table<7>(keys, hash));
+  print_row(workload, hash_primes[13].prime, table<13>(keys, hash));
+  print_row(workload, hash_primes[17].prime, table<17>(keys, hash));
+}
+
+int main(int argc, char *argv[]) {
+  const char *workload = NULL;
+  size_t size = 1 << 20;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      size = size_t(strtoull(argv[++i], NULL, 10));
+    } else if (workload == NULL && (strcmp(argv[i], "chart") == 0 ||
+                                    strcmp(argv[i], "string") == 0 ||
+                                    strcmp(argv[i], "integer") == 0)) {
+      workload = argv[i];
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [chart | string | integer] [--size bytes]\n",
+                   argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  std::mt19937_64 mt;
+  // lowercase words of 1 to 16 letters
+  std::vector<uint8_t> text(size);
+  for (size_t i = 0; i < size;) {
+    size_t length = 1 + size_t(mt() % 16);
+    for (size_t j = 0; j < length && i < size; j++) {
+      text[i++] = uint8_t('a' + mt() % 26);
+    }
+    if (i < size)
+      text[i++] = 0;
+  }
+  std::printf(
+      "workload,divisor,division_instruction,compiler,fastmod,fastmod_const\n");
+  if (workload == NULL || strcmp(workload, "chart") == 0) {
+    chart_sweep<3, 64>::run(text);
+  }
+  if (workload == NULL || strcmp(workload, "string") == 0) {
+    tables("string", word_hashes(text), [](uint32_t h) { return h; });
+  }
+  if (workload == NULL || strcmp(workload, "integer") == 0) {
+    std::vector<uint64_t> keys(size / sizeof(uint64_t));
+    for (auto &k : keys)
+      k = mt();
+    tables("integer", keys, hash_integer);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+#include "fastmod_hashmap.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+
+// Same capacities as prime_capacity, but using the % operator.
+class prime_modulo_capacity {
+public:
+  prime_modulo_capacity() : d(hash_primes[0].prime) {}
+  bool resize(size_t n) {
+    size_t i = 0;
+    while (hash_primes[i].prime < n) {
+      if (++i == hash_primes_count) {
+        return false;
+      }
+    }
+    d = hash_primes[i].prime;
+    return true;
+  }
+  size_t size() const { return d; }
+  size_t bucket(size_t hash) const {
+    uint64_t h = uint64_t(hash);
+    return uint32_t(h ^ (h >> 32)) % d;
+  }
+
+private:
+  uint32_t d;
+};
+
+template <typename F> uint64_t time(const F &x) {
+  auto start = std::chrono::high_resolution_clock::now();
+  x();
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = end - start;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
+  return ns;
+}
+
+template <class Map>
+void bench(const char *name, const std::vector<uint64_t> &keys,
+           const std::vector<uint64_t> &missing) {
+  Map map;
+  auto insertion = time([&]() {
+    for (uint64_t k : keys) {
+      map[k] = k;
+    }
+  });
+  auto hits = time([&]() {
+    uint64_t sum = 0;
+    for (uint64_t k : keys) {
+      sum += map.find(k) != map.end();
+    }
+    doNotOptimizeAway(sum);
+  });
+  auto misses = time([&]() {
+    uint64_t sum = 0;
+    for (uint64_t k : missing) {
+      sum += map.find(k) != map.end();
+    }
+    doNotOptimizeAway(sum);
+  });
+  std::fprintf(stderr,
+               "%-40s insert: %6.1f ns  hit: %6.1f ns  miss: %6.1f ns\n", name,
+               double(insertion) / keys.size(), double(hits) / keys.size(),
+               double(misses) / missing.size());
+}
+
+// gives the fastmod maps the same find/end interface as std::unordered_map
+template <class Capacity>
+struct bench_map
+    : hash_map<uint64_t, uint64_t, std::hash<uint64_t>,
+               std::equal_to<uint64_t>, Capacity> {
+  const uint64_t *end() const { return nullptr; }
+};
+
+void benchall(const char *title, const std::vector<uint64_t> &keys,
+              const std::vector<uint64_t> &missing) {
+  std::cout << "== " << title << std::endl;
+  bench<std::unordered_map<uint64_t, uint64_t>>("std::unordered_map", keys,
+                                                missing);
+  bench<bench_map<prime_capacity>>("hash_map (prime, fastmod)", keys,
+                                   missing);
+  bench<bench_map<prime_modulo_capacity>>("hash_map (prime, %)", keys,
+                                          missing);
+  bench<bench_map<power_of_two_capacity>>("hash_map (power of two, mask)",
+                                          keys, missing);
+}
+
+int main() {
+  std::mt19937_64 mt;
+  const size_t N = 1000000;
+  std::vector<uint64_t> keys(N), missing(N);
+  for (size_t i = 0; i < N; i++) {
+    keys[i] = mt();
+    missing[i] = mt();
+  }
+  benchall("random keys", keys, missing);
+  // std::hash is the identity for integers with common standard libraries:
+  // keys sharing their low bits collide when the capacity is a power of two
+  for (size_t i = 0; i < N; i++) {
+    keys[i] = 64 * i;
+    missing[i] = 64 * (i + N);
+  }
+  benchall("multiples of 64", keys, missing);
+}
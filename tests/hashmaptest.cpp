@@ -0,0 +1,215 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "fastmod_hashmap.h"
+
+using namespace fastmod;
+
+bool testprimes(bool verbose) {
+  for (size_t i = 0; i < hash_primes_count; i++) {
+    uint32_t p = hash_primes[i].prime;
+    if (hash_primes[i].M != computeM_u32(p)) {
+      printf("bad magic number for %u\n", p);
+      return false;
+    }
+    for (uint32_t f = 2; uint64_t(f) * f <= p; f++) {
+      if (p % f == 0) {
+        printf("%u is not prime\n", p);
+        return false;
+      }
+    }
+    if (i > 0 && p <= hash_primes[i - 1].prime) {
+      printf("primes are not sorted\n");
+      return false;
+    }
+  }
+  if (verbose)
+    printf("prime table ok!\n");
+  return true;
+}
+
+// random inserts, lookups and erasures checked against std::unordered_map
+template <class Map> bool testmap(const char *name, bool verbose) {
+  Map map;
+  std::unordered_map<uint64_t, uint64_t> reference;
+  std::mt19937_64 mt(1234);
+  for (int k = 0; k < 1000000; k++) {
+    uint64_t key = mt() % 100000;
+    uint64_t value = mt();
+    switch (mt() % 4) {
+    case 0: {
+      bool inserted = map.insert(key, value);
+      if (inserted != reference.insert(std::make_pair(key, value)).second) {
+        printf("%s: insert mismatch for %" PRIu64 "\n", name, key);
+        return false;
+      }
+      break;
+    }
+    case 1:
+      map[key] = value;
+      reference[key] = value;
+      break;
+    case 2:
+      if (map.erase(key) != (reference.erase(key) == 1)) {
+        printf("%s: erase mismatch for %" PRIu64 "\n", name, key);
+        return false;
+      }
+      break;
+    default: {
+      const uint64_t *v = map.find(key);
+      auto it = reference.find(key);
+      if ((v == nullptr) != (it == reference.end()) ||
+          (v != nullptr && *v != it->second)) {
+        printf("%s: find mismatch for %" PRIu64 "\n", name, key);
+        return false;
+      }
+    }
+    }
+    if (map.size() != reference.size()) {
+      printf("%s: size mismatch\n", name);
+      return false;
+    }
+  }
+  size_t visited = 0;
+  bool same = true;
+  map.for_each([&](uint64_t key, uint64_t value) {
+    visited++;
+    auto it = reference.find(key);
+    same = same && it != reference.end() && it->second == value;
+  });
+  if (!same || visited != reference.size()) {
+    printf("%s: for_each mismatch\n", name);
+    return false;
+  }
+  map.clear();
+  if (!map.empty() || map.contains(reference.begin()->first)) {
+    printf("%s: clear failed\n", name);
+    return false;
+  }
+  if (verbose)
+    printf("%s ok!\n", name);
+  return true;
+}
+
+bool testset(bool verbose) {
+  hash_set<std::string> set(100);
+  size_t capacity = set.capacity();
+  for (int i = 0; i < 100; i++) {
+    if (!set.insert(std::to_string(i)) || set.insert(std::to_string(i))) {
+      printf("set: insert failed\n");
+      return false;
+    }
+  }
+  if (set.capacity() != capacity) {
+    printf("set: reserve did not make enough room\n");
+    return false;
+  }
+  for (int i = 0; i < 200; i++) {
+    if (set.contains(std::to_string(i)) != (i < 100)) {
+      printf("set: contains failed\n");
+      return false;
+    }
+  }
+  for (int i = 0; i < 100; i += 2) {
+    set.erase(std::to_string(i));
+  }
+  if (set.size() != 50 || set.contains("0") || !set.contains("1")) {
+    printf("set: erase failed\n");
+    return false;
+  }
+  if (verbose)
+    printf("hash_set ok!\n");
+  return true;
+}
+
+bool testreserve(bool verbose) {
+  hash_set<uint32_t> set;
+  for (uint32_t i = 0; i < 1000; i++) {
+    set.insert(i);
+  }
+  // a small reserve must not shrink a populated table
+  size_t capacity = set.capacity();
+  set.reserve(10);
+  if (set.capacity() != capacity || set.size() != 1000 || !set.contains(999)) {
+    printf("reserve: a small reserve changed the table\n");
+    return false;
+  }
+  set.reserve(5000);
+  capacity = set.capacity();
+  if (capacity * 7 < 5000 * 10) {
+    printf("reserve: the table is too small\n");
+    return false;
+  }
+  for (uint32_t i = 1000; i < 5000; i++) {
+    set.insert(i);
+  }
+  if (set.capacity() != capacity || set.size() != 5000) {
+    printf("reserve: did not make enough room\n");
+    return false;
+  }
+  if (verbose)
+    printf("reserve ok!\n");
+  return true;
+}
+
+bool testexisting(bool verbose) {
+  // 4 keys fill 7 slots up to the 0.7 load factor: one more key rebuilds
+  hash_map<uint64_t, uint64_t> map;
+  for (uint64_t k = 0; k < 4; k++) {
+    map[k] = k;
+  }
+  const size_t capacity = map.capacity();
+  if (capacity != 7) {
+    printf("existing: expected 7 slots, got %zu\n", capacity);
+    return false;
+  }
+  const uint64_t *value = map.find(0);
+  map[0] = 5;
+  if (map.insert(1, 7) || map.capacity() != capacity ||
+      map.find(0) != value || *value != 5 || *map.find(1) != 1) {
+    printf("existing: a present key rebuilt the map\n");
+    return false;
+  }
+  hash_set<uint64_t> set;
+  for (uint64_t k = 0; k < 4; k++) {
+    set.insert(k);
+  }
+  if (set.insert(2) || set.capacity() != capacity) {
+    printf("existing: a present key rebuilt the set\n");
+    return false;
+  }
+  if (verbose)
+    printf("existing keys ok!\n");
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  bool isok = true;
+  bool verbose = false;
+  for (int i = 0; i < argc; ++i) {
+    if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+      verbose = true;
+      break;
+    }
+  }
+  isok = isok && testprimes(verbose);
+  isok = isok && testmap<hash_map<uint64_t, uint64_t>>("hash_map", verbose);
+  isok = isok &&
+         testmap<hash_map<uint64_t, uint64_t, std::hash<uint64_t>,
+                          std::equal_to<uint64_t>, power_of_two_capacity>>(
+             "hash_map (power of two)", verbose);
+  isok = isok && testset(verbose);
+  isok = isok && testreserve(verbose);
+  isok = isok && testexisting(verbose);
+  if (isok) {
+    printf("Code looks good.\n");
+    return 0;
+  } else {
+    printf("You have some failing tests.\n");
+    return -1;
+  }
+}
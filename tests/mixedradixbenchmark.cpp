@@ -0,0 +1,101 @@
+#include "fastmod.h"
+#include "performancecounters.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+template <typename T, typename F>
+uint64_t time(const F &x, const std::vector<T> &indices, std::vector<T> &out) {
+  counters().start();
+  auto start = std::chrono::high_resolution_clock::now();
+  x(indices.data(), out.data(), indices.size());
+  doNotOptimizeAway(out.back());
+  auto end = std::chrono::high_resolution_clock::now();
+  event_count counts = counters().end();
+  auto diff = end - start;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
+  std::fprintf(stderr, "Time: %zu\n", size_t(ns));
+  print_counters(counts, indices.size());
+  return ns;
+}
+
+template <typename T, size_t N> int bench(const T (&extents)[N]) {
+  std::mt19937_64 mt;
+  T total = 1;
+  for (T e : extents)
+    total *= e;
+  std::vector<T> indices(10000000);
+  for (auto &e : indices)
+    e = T(mt() % total);
+  std::vector<T> out(N * indices.size());
+  std::vector<T> expected(out.size());
+  // the extents are only known at runtime
+  std::vector<T> d(extents, extents + N);
+  doNotOptimizeAway(d.front());
+
+  std::cout << "== " << N << " extents, " << 8 * sizeof(T) << "-bit indices"
+            << std::endl;
+  std::cout << "timing chained division and modulo" << std::endl;
+  auto nativetime = time<T>(
+      [&d](const T *in, T *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          T index = in[i];
+          for (size_t k = N - 1; k > 0; k--) {
+            o[N * i + k] = index % d[k];
+            index /= d[k];
+          }
+          o[N * i] = index;
+        }
+      },
+      indices, expected);
+  mixed_radix<N, T> radix(extents);
+  std::cout << "timing mixed_radix::decode_batch" << std::endl;
+  auto fasttime = time<T>(
+      [&radix](const T *in, T *o, size_t n) { radix.decode_batch(in, o, n); },
+      indices, out);
+  if (out != expected) {
+    std::fprintf(stderr, "mismatch in mixed_radix::decode_batch\n");
+    return EXIT_FAILURE;
+  }
+  std::fprintf(stderr,
+               "mixed_radix::decode_batch is %lf as fast as chained "
+               "division\n",
+               (double)nativetime / fasttime);
+  return EXIT_SUCCESS;
+}
+
+int main() {
+  // a gather over an image batch, then seconds to days, hours, minutes and
+  // seconds
+  const uint32_t shape[4] = {16, 224, 224, 3};
+  const uint64_t clock[4] = {UINT64_C(100000000), 24, 60, 60};
+  if (bench(shape) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+  return bench(clock);
+}
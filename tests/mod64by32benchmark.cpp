@@ -0,0 +1,103 @@
+#include "fastmod.h"
+#include "performancecounters.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+template <typename F>
+uint64_t time(const F &x, const std::vector<uint64_t> &zomg) {
+  counters().start();
+  auto start = std::chrono::high_resolution_clock::now();
+  for (const auto e : zomg) {
+    doNotOptimizeAway(x(e));
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  event_count counts = counters().end();
+  auto diff = end - start;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
+  std::fprintf(stderr, "Time: %zu\n", size_t(ns));
+  print_counters(counts, zomg.size());
+  return ns;
+}
+
+int main() {
+  std::mt19937_64 mt;
+  uint32_t mod = uint32_t(mt() % (1 << 27));
+  std::vector<uint64_t> zomg(10000000);
+  for (auto &e : zomg)
+    e = mt();
+
+  const auto M64 = computeM_u64(mod);
+  const uint64_t M = computeM_u32(mod);
+  std::cout << "timing fastmod_u64_u32 " << std::endl;
+  auto fm32time =
+      time([M, mod](uint64_t v) { return fastmod_u64_u32(v, M, mod); }, zomg);
+  std::cout << "timing fastmod_u64 " << std::endl;
+  auto fm64time =
+      time([M64, mod](uint64_t v) { return fastmod_u64(v, M64, mod); }, zomg);
+  std::cout << "timing x modulo mod; " << std::endl;
+  auto modtime = time([mod](uint64_t x) { return x % mod; }, zomg);
+  std::fprintf(stderr,
+               "fastmod_u64_u32 is %lf as fast as fastmod_u64 and %lf as fast "
+               "as modding\n",
+               (double)fm64time / fm32time, (double)modtime / fm32time);
+
+  std::cout << "timing fastdiv_u64_u32 " << std::endl;
+  auto fd32time =
+      time([M, mod](uint64_t v) { return fastdiv_u64_u32(v, M, mod); }, zomg);
+  std::cout << "timing fastdiv_u64 " << std::endl;
+  auto fd64time = time([M64](uint64_t v) { return fastdiv_u64(v, M64); }, zomg);
+  std::cout << "timing x divided by mod; " << std::endl;
+  auto divtime = time([mod](uint64_t x) { return x / mod; }, zomg);
+  std::fprintf(stderr,
+               "fastdiv_u64_u32 is %lf as fast as fastdiv_u64 and %lf as fast "
+               "as dividing\n",
+               (double)fd64time / fd32time, (double)divtime / fd32time);
+
+  // (a * b) % p with a fixed factor b, as in polynomial hashing
+  const uint32_t b = uint32_t(mt()) % mod;
+  const uint32_t bM = computeM_mulmod_u32(b, M, mod);
+  std::cout << "timing mulmod_u32 " << std::endl;
+  auto mmtime = time(
+      [b, M, mod](uint64_t v) { return mulmod_u32(uint32_t(v), b, M, mod); },
+      zomg);
+  std::cout << "timing mulmod_precomp_u32 " << std::endl;
+  auto mmptime = time(
+      [b, bM, mod](uint64_t v) {
+        return mulmod_precomp_u32(uint32_t(v), b, bM, mod);
+      },
+      zomg);
+  std::cout << "timing x * b modulo mod; " << std::endl;
+  auto mulmodtime = time(
+      [b, mod](uint64_t v) { return (uint64_t(uint32_t(v)) * b) % mod; },
+      zomg);
+  std::fprintf(stderr,
+               "mulmod_u32 is %lf as fast as modding, mulmod_precomp_u32 is "
+               "%lf as fast as modding\n",
+               (double)mulmodtime / mmtime, (double)mulmodtime / mmptime);
+}
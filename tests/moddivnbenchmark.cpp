@@ -1,4 +1,5 @@
 #include "fastmod.h"
+#include "performancecounters.h"
 #include <chrono>
 #include <cstdio>
 #include <random>
@@ -28,14 +29,17 @@ template <typename T> inline void doNotOptimizeAway(T &&datum) {
 using namespace fastmod;
 template <typename F>
 uint64_t time(const F &x, const std::vector<uint64_t> &zomg) {
+  counters().start();
   auto start = std::chrono::high_resolution_clock::now();
   for (const auto e : zomg) {
     doNotOptimizeAway(x(e));
   }
   auto end = std::chrono::high_resolution_clock::now();
+  event_count counts = counters().end();
   auto diff = end - start;
   auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
   std::fprintf(stderr, "Time: %zu\n", size_t(ns));
+  print_counters(counts, zomg.size());
   return ns;
 }
 
@@ -52,8 +56,48 @@ int main() {
         return fastmod_u64(v, M, mod) + fastdiv_u64(v, M);
       },
       zomg);
+  auto fdm = time(
+      [M, mod](uint64_t v) {
+        uint64_t r;
+        uint64_t q = fastdivmod_u64(v, M, mod, &r);
+        return q + r;
+      },
+      zomg);
   auto sm = time([mod](uint64_t x) { return (x % mod) + (x / mod); }, zomg);
   std::fprintf(stderr, "fastmod + fastdiv is %lf as fast as x86 mod + div: \n",
                (double)sm / fm);
+  std::fprintf(stderr, "fastdivmod is %lf as fast as x86 mod + div: \n",
+               (double)sm / fdm);
+  std::fprintf(stderr, "fastdivmod is %lf as fast as fastmod + fastdiv: \n",
+               (double)fm / fdm);
 
+  // 32-bit values
+  const uint32_t mod32 = uint32_t(mod);
+  const uint64_t M32 = computeM_u32(mod32);
+  auto fm32 = time(
+      [M32, mod32](uint64_t v) {
+        return fastmod_u32(uint32_t(v), M32, mod32) +
+               fastdiv_u32(uint32_t(v), M32);
+      },
+      zomg);
+  auto fdm32 = time(
+      [M32, mod32](uint64_t v) {
+        uint32_t r;
+        uint32_t q = fastdivmod_u32(uint32_t(v), M32, mod32, &r);
+        return q + r;
+      },
+      zomg);
+  auto sm32 = time(
+      [mod32](uint64_t v) {
+        return (uint32_t(v) % mod32) + (uint32_t(v) / mod32);
+      },
+      zomg);
+  std::fprintf(stderr,
+               "32-bit fastmod + fastdiv is %lf as fast as x86 mod + div: \n",
+               (double)sm32 / fm32);
+  std::fprintf(stderr, "32-bit fastdivmod is %lf as fast as x86 mod + div: \n",
+               (double)sm32 / fdm32);
+  std::fprintf(stderr,
+               "32-bit fastdivmod is %lf as fast as fastmod + fastdiv: \n",
+               (double)fm32 / fdm32);
 }
@@ -1,4 +1,5 @@
 #include "fastmod.h"
+#include "performancecounters.h"
 #include <chrono>
 #include <cstdio>
 #include <iostream>
@@ -28,14 +29,17 @@ template <typename T> inline void doNotOptimizeAway(T &&datum) {
 
 using namespace fastmod;
 template <typename F> uint64_t time(const F &x, std::vector<uint64_t> &zomg) {
+  counters().start();
   auto start = std::chrono::high_resolution_clock::now();
   for (const auto e : zomg) {
     doNotOptimizeAway(x(e));
   }
   auto end = std::chrono::high_resolution_clock::now();
+  event_count counts = counters().end();
   auto diff = end - start;
   auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
   std::fprintf(stderr, "Time: %zu\n", size_t(ns));
+  print_counters(counts, zomg.size());
   return ns;
 }
 
@@ -75,5 +79,33 @@ int main() {
   std::fprintf(stderr,
                "masking is %lf as fast as fastmod and %lf as fast as modding\n",
                (double)fmtime / masktime, (double)modtime / masktime);
+  std::cout << "timing fastrange64 " << std::endl;
+  auto frtime = time([mod](uint64_t x) { return fastrange64(x, mod); }, zomg);
+  std::fprintf(stderr,
+               "fastrange64 is %lf as fast as fastmod, %lf as fast as modding "
+               "and %lf as fast as masking\n",
+               (double)fmtime / frtime, (double)modtime / frtime,
+               (double)masktime / frtime);
 
+  // 32-bit values, where fastmod_u32 needs only a 64-bit M
+  const uint32_t mod32 = uint32_t(mod);
+  const uint32_t t32 = uint32_t(t);
+  const uint64_t M32 = computeM_u32(mod32);
+  std::cout << "timing fastmod_u32 " << std::endl;
+  auto fmtime32 = time(
+      [M32, mod32](uint64_t x) { return fastmod_u32(uint32_t(x), M32, mod32); },
+      zomg);
+  std::cout << "timing 32-bit x modulo mod; " << std::endl;
+  auto modtime32 =
+      time([mod32](uint64_t x) { return uint32_t(x) % mod32; }, zomg);
+  std::cout << "timing 32-bit x & t; " << std::endl;
+  auto masktime32 = time([t32](uint64_t x) { return uint32_t(x) & t32; }, zomg);
+  std::cout << "timing fastrange32 " << std::endl;
+  auto frtime32 = time(
+      [mod32](uint64_t x) { return fastrange32(uint32_t(x), mod32); }, zomg);
+  std::fprintf(stderr,
+               "fastrange32 is %lf as fast as fastmod_u32, %lf as fast as "
+               "modding and %lf as fast as masking\n",
+               (double)fmtime32 / frtime32, (double)modtime32 / frtime32,
+               (double)masktime32 / frtime32);
 }
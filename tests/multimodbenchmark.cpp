@@ -0,0 +1,101 @@
+#include "fastmod_batch.h"
+#include "performancecounters.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+template <typename F>
+uint64_t time(const F &x, const std::vector<uint32_t> &zomg,
+              std::vector<uint32_t> &out) {
+  counters().start();
+  auto start = std::chrono::high_resolution_clock::now();
+  x(zomg.data(), out.data(), zomg.size());
+  doNotOptimizeAway(out.back());
+  auto end = std::chrono::high_resolution_clock::now();
+  event_count counts = counters().end();
+  auto diff = end - start;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
+  std::fprintf(stderr, "Time: %zu\n", size_t(ns));
+  print_counters(counts, zomg.size());
+  return ns;
+}
+
+void bench(size_t count, const std::vector<uint32_t> &zomg,
+           std::vector<uint32_t> &out) {
+  std::mt19937_64 mt(count);
+  std::vector<uint32_t> d(count);
+  std::vector<uint64_t> M(count);
+  for (size_t k = 0; k < count; k++) {
+    d[k] = uint32_t(mt() % (1 << 27)) + 1;
+    M[k] = computeM_u32(d[k]);
+  }
+  fastmod_u32_multi_t m;
+  fastmod_u32_multi_init(&m, d.data(), count);
+  std::cout << "== " << count << " divisors" << std::endl;
+  std::cout << "timing fastmod_u32 (one divisor at a time)" << std::endl;
+  auto fmtime = time(
+      [&d, &M, count](const uint32_t *in, uint32_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          for (size_t k = 0; k < count; k++) {
+            o[i * count + k] = fastmod_u32(in[i], M[k], d[k]);
+          }
+        }
+      },
+      zomg, out);
+  std::cout << "timing fastmod_u32_multi_batch" << std::endl;
+  auto fmbtime = time(
+      [&m](const uint32_t *in, uint32_t *o, size_t n) {
+        fastmod_u32_multi_batch(&m, in, n, o);
+      },
+      zomg, out);
+  std::cout << "timing x modulo mod; " << std::endl;
+  auto modtime = time(
+      [&d, count](const uint32_t *in, uint32_t *o, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+          for (size_t k = 0; k < count; k++) {
+            o[i * count + k] = in[i] % d[k];
+          }
+        }
+      },
+      zomg, out);
+  std::fprintf(stderr,
+               "fastmod_u32_multi_batch is %lf as fast as fastmod_u32 and %lf "
+               "as fast as modding\n",
+               (double)fmtime / fmbtime, (double)modtime / fmbtime);
+}
+
+int main() {
+  std::mt19937_64 mt;
+  std::vector<uint32_t> zomg(1000000);
+  for (auto &e : zomg)
+    e = uint32_t(mt());
+  std::vector<uint32_t> out(zomg.size() * FASTMOD_MULTI_MAX);
+  for (size_t count : {4, 8, 16}) {
+    bench(count, zomg, out);
+  }
+}
@@ -0,0 +1,189 @@
+// Exhaustive tests of the 16-bit and 8-bit functions: every divisor with
+// every dividend.
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "fastmod_dispatch.h"
+
+using namespace fastmod;
+
+// whether the AVX2 kernels were compiled and the processor runs them
+static bool avx2_available() {
+#ifdef FASTMOD_BATCH_AVX2
+  const fastmod_dispatch_t *kernel;
+  for (int k = 0; (kernel = fastmod_dispatch_kernel(k)) != NULL; k++) {
+    if (strcmp(kernel->name, "avx2") == 0)
+      return fastmod_dispatch_supported(k);
+  }
+#endif
+  return false;
+}
+
+// in[i] = i modulo 2^bits, expected[i] = in[i] % d or in[i] / d, counted
+// without a division
+template <typename T>
+static void expected_values(std::vector<T> &in, std::vector<T> &mod,
+                            std::vector<T> &div, uint32_t d) {
+  uint32_t r = 0, q = 0;
+  for (size_t i = 0; i < in.size(); i++) {
+    in[i] = T(i);
+    if (in[i] == 0)
+      r = q = 0;
+    mod[i] = T(r);
+    div[i] = T(q);
+    if (++r == d) {
+      r = 0;
+      q++;
+    }
+  }
+}
+
+template <typename T>
+static bool check_batch(const char *name, const std::vector<T> &in,
+                        const std::vector<T> &out,
+                        const std::vector<T> &expected, uint32_t d) {
+  for (size_t i = 0; i < in.size(); i++) {
+    if (out[i] != expected[i]) {
+      printf("(bad %s) problem with divisor %" PRIu32 " and dividend %" PRIu32
+             "\n",
+             name, d, uint32_t(in[i]));
+      return false;
+    }
+  }
+  return true;
+}
+
+bool testunsigned16(bool verbose) {
+  const bool avx2 = avx2_available();
+  // all dividends, then a tail that the vector loops leave to scalar code
+  const size_t n = 0x10000 + 15;
+  std::vector<uint16_t> in(n), out(n), mod(n), div(n);
+  for (uint32_t d = 1; d <= 0xFFFF; d++) {
+    const uint32_t M = computeM_u16(uint16_t(d));
+    expected_values(in, mod, div, d);
+    for (uint32_t a = 0; a <= 0xFFFF; a++) {
+      if (fastmod_u16(uint16_t(a), M, uint16_t(d)) != mod[a]) {
+        printf("(bad fastmod_u16) problem with divisor %" PRIu32
+               " and dividend %" PRIu32 "\n",
+               d, a);
+        return false;
+      }
+      if (d > 1 && fastdiv_u16(uint16_t(a), M) != div[a]) {
+        printf("(bad fastdiv_u16) problem with divisor %" PRIu32
+               " and dividend %" PRIu32 "\n",
+               d, a);
+        return false;
+      }
+      if (is_divisible_u16(uint16_t(a), M) != (mod[a] == 0)) {
+        printf("(bad is_divisible_u16) problem with divisor %" PRIu32
+               " and dividend %" PRIu32 "\n",
+               d, a);
+        return false;
+      }
+    }
+    fastmod_u16_batch(in.data(), out.data(), n, M, uint16_t(d));
+    if (!check_batch("fastmod_u16_batch", in, out, mod, d))
+      return false;
+#ifdef FASTMOD_BATCH_AVX2
+    if (avx2) {
+      fastmod_u16_batch_avx2(in.data(), out.data(), n, M, uint16_t(d));
+      if (!check_batch("fastmod_u16_batch_avx2", in, out, mod, d))
+        return false;
+    }
+#endif
+    if (d == 1)
+      continue; // fastdiv does not support d = 1
+    fastdiv_u16_batch(in.data(), out.data(), n, M);
+    if (!check_batch("fastdiv_u16_batch", in, out, div, d))
+      return false;
+#ifdef FASTMOD_BATCH_AVX2
+    if (avx2) {
+      fastdiv_u16_batch_avx2(in.data(), out.data(), n, M);
+      if (!check_batch("fastdiv_u16_batch_avx2", in, out, div, d))
+        return false;
+    }
+#endif
+  }
+  if (verbose)
+    printf("16-bit test passed with all divisors%s.\n",
+           avx2 ? " (and the AVX2 kernels)" : "");
+  return true;
+}
+
+bool testunsigned8(bool verbose) {
+  const bool avx2 = avx2_available();
+  const size_t n = 0x100 + 31;
+  std::vector<uint8_t> in(n), out(n), mod(n), div(n);
+  for (uint32_t d = 1; d <= 0xFF; d++) {
+    const uint16_t M = computeM_u8(uint8_t(d));
+    expected_values(in, mod, div, d);
+    for (uint32_t a = 0; a <= 0xFF; a++) {
+      if (fastmod_u8(uint8_t(a), M, uint8_t(d)) != mod[a]) {
+        printf("(bad fastmod_u8) problem with divisor %" PRIu32
+               " and dividend %" PRIu32 "\n",
+               d, a);
+        return false;
+      }
+      if (d > 1 && fastdiv_u8(uint8_t(a), M) != div[a]) {
+        printf("(bad fastdiv_u8) problem with divisor %" PRIu32
+               " and dividend %" PRIu32 "\n",
+               d, a);
+        return false;
+      }
+      if (is_divisible_u8(uint8_t(a), M) != (mod[a] == 0)) {
+        printf("(bad is_divisible_u8) problem with divisor %" PRIu32
+               " and dividend %" PRIu32 "\n",
+               d, a);
+        return false;
+      }
+    }
+    fastmod_u8_batch(in.data(), out.data(), n, M, uint8_t(d));
+    if (!check_batch("fastmod_u8_batch", in, out, mod, d))
+      return false;
+#ifdef FASTMOD_BATCH_AVX2
+    if (avx2) {
+      fastmod_u8_batch_avx2(in.data(), out.data(), n, M, uint8_t(d));
+      if (!check_batch("fastmod_u8_batch_avx2", in, out, mod, d))
+        return false;
+    }
+#endif
+    if (d == 1)
+      continue;
+    fastdiv_u8_batch(in.data(), out.data(), n, M);
+    if (!check_batch("fastdiv_u8_batch", in, out, div, d))
+      return false;
+#ifdef FASTMOD_BATCH_AVX2
+    if (avx2) {
+      fastdiv_u8_batch_avx2(in.data(), out.data(), n, M);
+      if (!check_batch("fastdiv_u8_batch_avx2", in, out, div, d))
+        return false;
+    }
+#endif
+  }
+  if (verbose)
+    printf("8-bit test passed with all divisors%s.\n",
+           avx2 ? " (and the AVX2 kernels)" : "");
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  bool isok = true;
+  bool verbose = false;
+  for (int i = 0; i < argc; ++i) {
+    if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+      verbose = true;
+      break;
+    }
+  }
+  isok = isok && testunsigned8(verbose);
+  isok = isok && testunsigned16(verbose);
+  if (isok) {
+    printf("Code looks good.\n");
+    return 0;
+  } else {
+    printf("You have some failing tests.\n");
+    return -1;
+  }
+}
@@ -0,0 +1,123 @@
+// Scaling of batch_pool from one thread to one per hardware thread.
+//
+// Usage: parallelbenchmark [values]
+//
+// For each number of threads, we report the bandwidth (bytes read and
+// written per second) of a parallel copy, which is roughly the ceiling set
+// by the memory, and of fastmod_u32_batch and fastdiv_u32_batch.
+#include "fastmod_parallel.h"
+#include "performancecounters.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+
+// best of a few runs, in nanoseconds
+template <typename F> uint64_t time(const F &x, std::vector<uint32_t> &out) {
+  uint64_t best = UINT64_MAX;
+  for (int r = 0; r < 3; r++) {
+    counters().start();
+    auto start = std::chrono::high_resolution_clock::now();
+    x();
+    doNotOptimizeAway(out.back());
+    auto end = std::chrono::high_resolution_clock::now();
+    event_count counts = counters().end();
+    auto diff = end - start;
+    uint64_t ns = uint64_t(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count());
+    if (ns < best)
+      best = ns;
+    if (r == 0)
+      print_counters(counts, out.size());
+  }
+  return best;
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = size_t(1) << 25;
+  if (argc > 1)
+    n = size_t(strtoull(argv[1], NULL, 10));
+  if (n == 0) {
+    std::fprintf(stderr, "usage: %s [values]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  size_t hardware = std::thread::hardware_concurrency();
+  if (hardware == 0)
+    hardware = 1;
+  std::vector<uint32_t> in(n), out(n);
+  std::mt19937_64 mt;
+  for (auto &e : in)
+    e = uint32_t(mt());
+  const uint32_t d = uint32_t(mt() % (1 << 27)) + 2;
+  const uint64_t M = computeM_u32(d);
+  const double bytes = double(2 * n * sizeof(uint32_t));
+  std::printf("%zu values, divisor %u, kernel %s\n", n, d,
+              fastmod_dispatch_name());
+  std::printf("%8s %12s %12s %12s %10s\n", "threads", "copy GB/s",
+              "mod GB/s", "div GB/s", "speedup");
+  double single = 0;
+  for (size_t t = 1;; t *= 2) {
+    if (t > hardware)
+      t = hardware;
+    batch_pool pool(t);
+    // first touch: the pages of a chunk belong to the thread that uses it
+    std::vector<uint32_t> local_in(n), local_out(n);
+    pool.parallel_for(n, [&](size_t begin, size_t end) {
+      memcpy(local_in.data() + begin, in.data() + begin,
+             (end - begin) * sizeof(uint32_t));
+      memset(local_out.data() + begin, 0, (end - begin) * sizeof(uint32_t));
+    });
+    uint64_t copy = time(
+        [&]() {
+          pool.parallel_for(n, [&](size_t begin, size_t end) {
+            memcpy(local_out.data() + begin, local_in.data() + begin,
+                   (end - begin) * sizeof(uint32_t));
+          });
+        },
+        local_out);
+    uint64_t mod = time(
+        [&]() {
+          pool.fastmod_u32_batch(local_in.data(), local_out.data(), n, M, d);
+        },
+        local_out);
+    uint64_t div = time(
+        [&]() {
+          pool.fastdiv_u32_batch(local_in.data(), local_out.data(), n, M);
+        },
+        local_out);
+    if (t == 1)
+      single = double(mod);
+    std::printf("%8zu %12.2f %12.2f %12.2f %10.2f\n", t, bytes / double(copy),
+                bytes / double(mod), bytes / double(div), single / double(mod));
+    if (t == hardware)
+      break;
+  }
+  return EXIT_SUCCESS;
+}
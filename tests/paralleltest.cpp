@@ -0,0 +1,128 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+#include "fastmod_parallel.h"
+
+using namespace fastmod;
+
+// every index is visited once, by chunks starting on a multiple of 64
+bool testchunks(batch_pool &pool, size_t n, bool verbose) {
+  std::vector<uint8_t> visits(n);
+  bool aligned = true;
+  pool.parallel_for(n, [&](size_t begin, size_t end) {
+    if (begin % 64 != 0 || begin >= end || end > n)
+      aligned = false;
+    for (size_t i = begin; i < end; i++)
+      visits[i]++;
+  });
+  for (size_t i = 0; i < n; i++) {
+    if (visits[i] != 1 || !aligned) {
+      printf("(bad parallel_for) %zu threads, n = %zu, index %zu\n",
+             pool.size(), n, i);
+      return false;
+    }
+  }
+  if (verbose)
+    printf("parallel_for with %zu threads and n = %zu ok!\n", pool.size(), n);
+  return true;
+}
+
+// the pool gives the same results as the single-threaded functions
+bool testpool(batch_pool &pool, size_t n, uint32_t d, bool verbose) {
+  std::mt19937_64 mt(n + d);
+  std::vector<uint32_t> in(n);
+  for (auto &e : in)
+    e = uint32_t(mt());
+  const uint64_t M = computeM_u32(d);
+  std::vector<uint32_t> out(n), expected(n);
+  pool.fastmod_u32_batch(in.data(), out.data(), n, M, d);
+  fastmod_u32_batch_scalar(in.data(), expected.data(), n, M, d);
+  if (out != expected) {
+    printf("(bad batch_pool::fastmod_u32_batch) %zu threads, n = %zu, d = %u\n",
+           pool.size(), n, d);
+    return false;
+  }
+  if (d > 1) {
+    pool.fastdiv_u32_batch(in.data(), out.data(), n, M);
+    fastdiv_u32_batch_scalar(in.data(), expected.data(), n, M);
+    if (out != expected) {
+      printf("(bad batch_pool::fastdiv_u32_batch) %zu threads, n = %zu, "
+             "d = %u\n",
+             pool.size(), n, d);
+      return false;
+    }
+  }
+  // all ones so that the bits past n must be cleared
+  std::vector<uint64_t> bits((n + 63) / 64, ~uint64_t(0));
+  std::vector<uint64_t> expected_bits((n + 63) / 64);
+  pool.is_divisible_u32_batch(in.data(), bits.data(), n, M);
+  is_divisible_u32_batch_scalar(in.data(), expected_bits.data(), n, M);
+  if (bits != expected_bits) {
+    printf("(bad batch_pool::is_divisible_u32_batch) %zu threads, n = %zu, "
+           "d = %u\n",
+           pool.size(), n, d);
+    return false;
+  }
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+  std::vector<uint64_t> in64(n), out64(n), expected64(n);
+  for (auto &e : in64)
+    e = mt();
+  const uint64_t d64 = (uint64_t(d) << 29) + 1;
+  const fastmod_u128_t M64 = computeM_u64(d64);
+  pool.fastmod_u64_batch(in64.data(), out64.data(), n, M64, d64);
+  fastmod_u64_batch_scalar(in64.data(), expected64.data(), n, M64, d64);
+  if (out64 != expected64) {
+    printf("(bad batch_pool::fastmod_u64_batch) %zu threads, n = %zu\n",
+           pool.size(), n);
+    return false;
+  }
+  pool.fastdiv_u64_batch(in64.data(), out64.data(), n, M64);
+  fastdiv_u64_batch_scalar(in64.data(), expected64.data(), n, M64);
+  if (out64 != expected64) {
+    printf("(bad batch_pool::fastdiv_u64_batch) %zu threads, n = %zu\n",
+           pool.size(), n);
+    return false;
+  }
+#endif
+  if (verbose)
+    printf("batch_pool with %zu threads, n = %zu and d = %u ok!\n",
+           pool.size(), n, d);
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  bool isok = true;
+  bool verbose = false;
+  for (int i = 0; i < argc; ++i) {
+    if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+      verbose = true;
+      break;
+    }
+  }
+  const size_t chunk = batch_pool::min_chunk;
+  const size_t sizes[] = {0, 1, 63, 64, 65, chunk, chunk + 1,
+                          3 * chunk + 17, 7 * chunk + 64, 20 * chunk + 5};
+  const uint32_t divisors[] = {1, 3, 64, 1000003, 0xfffffffb};
+  const size_t threads[] = {1, 2, 3, 8};
+  for (size_t t : threads) {
+    batch_pool pool(t);
+    for (size_t n : sizes) {
+      isok = isok && testchunks(pool, n, verbose);
+      for (uint32_t d : divisors) {
+        isok = isok && testpool(pool, n, d, verbose);
+      }
+    }
+  }
+  batch_pool hardware; // one thread per hardware thread
+  isok = isok && testpool(hardware, 5 * chunk + 3, 7, verbose);
+  if (isok) {
+    printf("Code looks good.\n");
+    return 0;
+  } else {
+    printf("You have some failing tests.\n");
+    return -1;
+  }
+}
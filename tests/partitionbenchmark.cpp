@@ -0,0 +1,96 @@
+// Compares the scatter with software write-combining buffers of
+// fastmod::partitioner with a naive scatter (one store per value).
+//
+// Usage: partitionbenchmark [values]
+#include "fastmod_partition.h"
+#include "performancecounters.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+
+// best of a few runs, in nanoseconds
+template <typename F> uint64_t time(const F &x, std::vector<uint64_t> &out) {
+  uint64_t best = UINT64_MAX;
+  for (int r = 0; r < 3; r++) {
+    counters().start();
+    auto start = std::chrono::high_resolution_clock::now();
+    x();
+    doNotOptimizeAway(out.back());
+    auto end = std::chrono::high_resolution_clock::now();
+    event_count counts = counters().end();
+    auto diff = end - start;
+    uint64_t ns = uint64_t(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count());
+    if (ns < best)
+      best = ns;
+    if (r == 0)
+      print_counters(counts, out.size());
+  }
+  return best;
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = size_t(1) << 24;
+  if (argc > 1)
+    n = size_t(strtoull(argv[1], NULL, 10));
+  if (n == 0) {
+    std::fprintf(stderr, "usage: %s [values]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::mt19937_64 mt;
+  std::vector<uint32_t> hashes(n);
+  std::vector<uint64_t> values(n), out(n);
+  for (size_t i = 0; i < n; i++) {
+    values[i] = mt();
+    hashes[i] = uint32_t(values[i] >> 32);
+  }
+  std::printf("%zu 8-byte values\n", n);
+  std::printf("%8s %14s %14s %10s\n", "parts", "naive ns/val", "buffered ns/val",
+              "speedup");
+  const uint32_t counts[] = {10, 64, 100, 1000, 5000, 20000, 100003};
+  for (uint32_t parts : counts) {
+    partitioner p(parts);
+    std::vector<size_t> offsets(parts + 1);
+    uint64_t naive = time(
+        [&]() {
+          p.partition(hashes.data(), values.data(), n, out.data(),
+                      offsets.data(), partitioner::direct);
+        },
+        out);
+    uint64_t buffered = time(
+        [&]() {
+          p.partition(hashes.data(), values.data(), n, out.data(),
+                      offsets.data(), partitioner::buffered);
+        },
+        out);
+    std::printf("%8u %14.3f %14.3f %10.2f\n", parts, double(naive) / double(n),
+                double(buffered) / double(n), double(naive) / double(buffered));
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+#include "fastmod_partition.h"
+
+using namespace fastmod;
+
+struct pair64 {
+  uint64_t key;
+  uint64_t payload;
+  bool operator!=(const pair64 &o) const {
+    return key != o.key || payload != o.payload;
+  }
+};
+
+struct triple32 { // 12 bytes, scattered one at a time
+  uint32_t a, b, c;
+  bool operator!=(const triple32 &o) const {
+    return a != o.a || b != o.b || c != o.c;
+  }
+};
+
+template <class T> T make_value(uint64_t x);
+template <> uint32_t make_value<uint32_t>(uint64_t x) { return uint32_t(x); }
+template <> uint64_t make_value<uint64_t>(uint64_t x) { return x; }
+template <> pair64 make_value<pair64>(uint64_t x) {
+  pair64 p = {x, ~x};
+  return p;
+}
+template <> triple32 make_value<triple32>(uint64_t x) {
+  triple32 t = {uint32_t(x), uint32_t(x >> 32), uint32_t(x * 3)};
+  return t;
+}
+
+// compares partition with a stable counting sort, shift moves the output
+// away from a cache line boundary
+template <class T>
+bool testpartition(uint32_t parts, size_t n, size_t shift,
+                   partitioner::scatter_method method, bool verbose) {
+  std::mt19937_64 mt(parts * 31 + n);
+  std::vector<uint32_t> hashes(n);
+  std::vector<T> values(n);
+  for (size_t i = 0; i < n; i++) {
+    uint64_t x = mt();
+    hashes[i] = uint32_t(x);
+    values[i] = make_value<T>(x);
+  }
+  std::vector<std::vector<T>> expected(parts);
+  for (size_t i = 0; i < n; i++) {
+    expected[hashes[i] % parts].push_back(values[i]);
+  }
+  partitioner p(parts);
+  std::vector<T> storage(n + shift + 1);
+  T *out = storage.data() + shift;
+  std::vector<size_t> offsets(parts + 1);
+  p.partition(hashes.data(), values.data(), n, out, offsets.data(), method);
+  for (uint32_t k = 0; k < parts; k++) {
+    if (offsets[k + 1] - offsets[k] != expected[k].size()) {
+      printf("(bad partitioner) wrong size for partition %u of %u, n = %zu\n",
+             k, parts, n);
+      return false;
+    }
+    for (size_t j = 0; j < expected[k].size(); j++) {
+      if (out[offsets[k] + j] != expected[k][j]) {
+        printf("(bad partitioner) partition %u of %u, value %zu, n = %zu, "
+               "shift = %zu\n",
+               k, parts, j, n, shift);
+        return false;
+      }
+    }
+  }
+  if (offsets[parts] != n) {
+    printf("(bad partitioner) wrong total\n");
+    return false;
+  }
+  if (verbose)
+    printf("partitioner with %zu-byte values, %u parts, n = %zu, shift = %zu "
+           "ok!\n",
+           sizeof(T), parts, n, shift);
+  return true;
+}
+
+template <class T> bool testpartitions(bool verbose) {
+  const uint32_t parts[] = {1, 2, 3, 7, 16, 100, 1000, 4099};
+  const size_t sizes[] = {0, 1, 15, 16, 17, 1000, 100000};
+  for (uint32_t d : parts) {
+    for (size_t n : sizes) {
+      for (size_t shift = 0; shift < 3; shift++) {
+        if (!testpartition<T>(d, n, shift, partitioner::buffered, verbose) ||
+            !testpartition<T>(d, n, shift, partitioner::direct, verbose))
+          return false;
+      }
+    }
+  }
+  // large enough for the non-temporal stores
+  const size_t big = partitioner::stream_threshold / sizeof(T) + 12345;
+  return testpartition<T>(1000, big, 0, partitioner::automatic, verbose) &&
+         testpartition<T>(31, big, 1, partitioner::buffered, verbose);
+}
+
+int main(int argc, char *argv[]) {
+  bool isok = true;
+  bool verbose = false;
+  for (int i = 0; i < argc; ++i) {
+    if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+      verbose = true;
+      break;
+    }
+  }
+  isok = isok && testpartitions<uint32_t>(verbose);
+  isok = isok && testpartitions<uint64_t>(verbose);
+  isok = isok && testpartitions<pair64>(verbose);
+  isok = isok && testpartitions<triple32>(verbose);
+  partitioner p(10);
+  isok = isok && p.parts() == 10 && p.bucket(12345) == 5;
+  if (isok) {
+    printf("Code looks good.\n");
+    return 0;
+  } else {
+    printf("You have some failing tests.\n");
+    return -1;
+  }
+}
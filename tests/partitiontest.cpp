@@ -0,0 +1,152 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "partition.h"
+
+static std::vector<uint8_t> read_file(const std::string &path) {
+  std::vector<uint8_t> content;
+  FILE *f = fopen(path.c_str(), "rb");
+  if (f == NULL)
+    return content;
+  uint8_t buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    content.insert(content.end(), buffer, buffer + n);
+  fclose(f);
+  return content;
+}
+
+// partitions a generated file and checks that each record went, in order,
+// to the partition given by its key
+bool testpartition(const std::string &dir, uint64_t records, size_t width,
+                   size_t key_width, uint32_t parts, size_t buffer_size,
+                   bool verbose) {
+  const std::string input = dir + "/input.bin";
+  const std::string prefix = dir + "/part";
+  std::string error = partition::generate_file(input.c_str(), records, width);
+  if (!error.empty()) {
+    printf("%s\n", error.c_str());
+    return false;
+  }
+  partition::options opt;
+  opt.input = input.c_str();
+  opt.output_prefix = prefix.c_str();
+  opt.width = width;
+  opt.key_width = key_width;
+  opt.parts = parts;
+  opt.buffer_size = buffer_size;
+  partition::stats s;
+  error = partition::partition_file(opt, &s);
+  if (!error.empty() || s.records != records || s.bytes != records * width) {
+    printf("(bad partition_file) %s\n", error.c_str());
+    return false;
+  }
+  const std::vector<uint8_t> in = read_file(input);
+  std::vector<std::vector<uint8_t>> out(parts);
+  std::vector<size_t> offsets(parts);
+  for (uint32_t k = 0; k < parts; k++) {
+    out[k] = read_file(partition::partition_path(prefix.c_str(), k));
+  }
+  for (uint64_t i = 0; i < records; i++) {
+    const uint8_t *record = in.data() + i * width;
+    uint64_t key;
+    if (key_width == 4) {
+      uint32_t key32;
+      memcpy(&key32, record, sizeof(key32));
+      key = key32;
+    } else {
+      memcpy(&key, record, sizeof(key));
+    }
+    const uint32_t k = uint32_t(key % parts);
+    if (offsets[k] + width > out[k].size() ||
+        memcmp(out[k].data() + offsets[k], record, width) != 0) {
+      printf("(bad partition_file) record %" PRIu64 " is not next in "
+             "partition %u of %u (width %zu, key %zu)\n",
+             i, k, parts, width, key_width);
+      return false;
+    }
+    offsets[k] += width;
+  }
+  for (uint32_t k = 0; k < parts; k++) {
+    if (offsets[k] != out[k].size()) {
+      printf("(bad partition_file) partition %u has extra records\n", k);
+      return false;
+    }
+    remove(partition::partition_path(prefix.c_str(), k).c_str());
+  }
+  remove(input.c_str());
+  if (verbose)
+    printf("%" PRIu64 " records of %zu bytes in %u partitions ok!\n", records,
+           width, parts);
+  return true;
+}
+
+bool testerrors(const std::string &dir, bool verbose) {
+  const std::string input = dir + "/odd.bin";
+  const std::string prefix = dir + "/part";
+  partition::generate_file(input.c_str(), 3, 4); // 12 bytes
+  partition::options opt;
+  opt.input = input.c_str();
+  opt.output_prefix = prefix.c_str();
+  opt.width = 8;
+  opt.parts = 3;
+  bool ok = !partition::partition_file(opt, NULL).empty();
+  opt.width = 12;
+  opt.key_width = 5;
+  ok = ok && !partition::partition_file(opt, NULL).empty();
+  opt.key_width = 4;
+  opt.parts = 0;
+  ok = ok && !partition::partition_file(opt, NULL).empty();
+  const std::string missing = dir + "/missing.bin";
+  opt.input = missing.c_str();
+  opt.parts = 3;
+  ok = ok && !partition::partition_file(opt, NULL).empty();
+  remove(input.c_str());
+  if (!ok) {
+    printf("(bad partition_file) invalid input accepted\n");
+    return false;
+  }
+  if (verbose)
+    printf("invalid inputs rejected!\n");
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  bool isok = true;
+  bool verbose = false;
+  for (int i = 0; i < argc; ++i) {
+    if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+      verbose = true;
+      break;
+    }
+  }
+  const char *tmp = getenv("TMPDIR");
+  std::string pattern = std::string(tmp != NULL ? tmp : "/tmp") +
+                        "/fastmod_partition_XXXXXX";
+  std::vector<char> name(pattern.begin(), pattern.end());
+  name.push_back('\0');
+  if (mkdtemp(name.data()) == NULL) {
+    printf("cannot create a temporary directory\n");
+    return -1;
+  }
+  const std::string dir(name.data());
+  isok = isok && testpartition(dir, 100000, 8, 8, 10, 0, verbose);
+  isok = isok && testpartition(dir, 100000, 4, 4, 7, 0, verbose);
+  isok = isok && testpartition(dir, 50000, 16, 8, 3, 64, verbose);
+  isok = isok && testpartition(dir, 50000, 12, 4, 1000, 100, verbose);
+  isok = isok && testpartition(dir, 1000, 8, 8, 1, 0, verbose);
+  isok = isok && testpartition(dir, 0, 8, 8, 5, 0, verbose);
+  isok = isok && testerrors(dir, verbose);
+  rmdir(dir.c_str());
+  if (isok) {
+    printf("Code looks good.\n");
+    return 0;
+  } else {
+    printf("You have some failing tests.\n");
+    return -1;
+  }
+}
@@ -0,0 +1,135 @@
+#ifndef FASTMOD_PERFORMANCE_COUNTERS_H
+#define FASTMOD_PERFORMANCE_COUNTERS_H
+
+/**
+ * Hardware performance counters for the benchmarks, through perf_event_open
+ * under Linux.
+ * Usage:
+ *  counters().start();
+ *  ... // code under test
+ *  event_count c = counters().end();
+ *  print_counters(c, number_of_operations);
+ *
+ * print_counters writes the cycles, the instructions, the IPC and the branch
+ * misses per operation to stderr. When the counters are unavailable (other
+ * systems, virtual machines and containers without a PMU, or a restrictive
+ * /proc/sys/kernel/perf_event_paranoid), c.valid is false and nothing is
+ * printed. Set the environment variable FASTMOD_NO_COUNTERS to disable them.
+ **/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#include <asm/unistd.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+struct event_count {
+  bool valid = false;
+  uint64_t cycles = 0;
+  uint64_t instructions = 0;
+  uint64_t branch_misses = 0;
+};
+
+class event_collector {
+public:
+  event_collector() {
+#if defined(__linux__)
+    if (getenv("FASTMOD_NO_COUNTERS") != NULL)
+      return;
+    const uint64_t configs[event_total] = {PERF_COUNT_HW_CPU_CYCLES,
+                                           PERF_COUNT_HW_INSTRUCTIONS,
+                                           PERF_COUNT_HW_BRANCH_MISSES};
+    for (int i = 0; i < event_total; i++) {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = configs[i];
+      attr.disabled = (i == 0); // the group starts with its leader
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      // this process, any processor, grouped with the first event
+      fds[i] = int(syscall(__NR_perf_event_open, &attr, 0, -1,
+                           i == 0 ? -1 : fds[0], 0));
+      if (fds[i] < 0) {
+        close_all();
+        return;
+      }
+    }
+#endif
+  }
+  ~event_collector() { close_all(); }
+  event_collector(const event_collector &) = delete;
+  event_collector &operator=(const event_collector &) = delete;
+
+  bool has_events() const { return fds[0] >= 0; }
+
+  void start() {
+#if defined(__linux__)
+    if (has_events()) {
+      ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+  }
+
+  event_count end() {
+    event_count c;
+#if defined(__linux__)
+    if (has_events()) {
+      ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+      // the number of events followed by their values
+      uint64_t values[1 + event_total];
+      if (read(fds[0], values, sizeof(values)) == ssize_t(sizeof(values)) &&
+          values[0] == event_total) {
+        c.valid = true;
+        c.cycles = values[1];
+        c.instructions = values[2];
+        c.branch_misses = values[3];
+      }
+    }
+#endif
+    return c;
+  }
+
+private:
+  enum { event_total = 3 };
+  int fds[event_total] = {-1, -1, -1};
+
+  void close_all() {
+    for (int i = 0; i < event_total; i++) {
+#if defined(__linux__)
+      if (fds[i] >= 0)
+        close(fds[i]);
+#endif
+      fds[i] = -1;
+    }
+  }
+};
+
+// the collector shared by the benchmarks of a program
+inline event_collector &counters() {
+  static event_collector collector;
+  return collector;
+}
+
+inline void print_counters(const event_count &c, size_t ops) {
+  if (!c.valid || ops == 0 || c.cycles == 0)
+    return;
+  std::fprintf(stderr,
+               "Counters: %.3f cycles/op, %.3f instructions/op, IPC %.3f, "
+               "%.4f branch misses/op\n",
+               double(c.cycles) / double(ops),
+               double(c.instructions) / double(ops),
+               double(c.instructions) / double(c.cycles),
+               double(c.branch_misses) / double(ops));
+}
+
+#endif // FASTMOD_PERFORMANCE_COUNTERS_H
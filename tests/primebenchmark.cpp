@@ -0,0 +1,185 @@
+#include "fastmod.h"
+#include "performancecounters.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+
+// Miller-Rabin with the same bases as is_prime_u32 and is_prime_u64, but
+// reducing with the hardware division
+uint32_t naive_powmod_u32(uint64_t a, uint32_t e, uint32_t p) {
+  uint64_t result = 1;
+  while (e != 0) {
+    if (e & 1)
+      result = result * a % p;
+    a = a * a % p;
+    e >>= 1;
+  }
+  return uint32_t(result);
+}
+
+bool naive_is_prime_u32(uint32_t n) {
+  if (n < 4)
+    return n >= 2;
+  if ((n & 1) == 0)
+    return false;
+  uint32_t odd = n - 1;
+  int s = 0;
+  while ((odd & 1) == 0) {
+    odd >>= 1;
+    s++;
+  }
+  for (uint32_t base : {2, 7, 61}) {
+    uint32_t a = base % n;
+    if (a == 0)
+      continue;
+    uint64_t x = naive_powmod_u32(a, odd, n);
+    if ((x == 1) || (x == n - 1))
+      continue;
+    int j = 1;
+    for (; j < s; j++) {
+      x = x * x % n;
+      if (x == n - 1)
+        break;
+    }
+    if (j == s)
+      return false;
+  }
+  return true;
+}
+
+uint64_t naive_mulmod_u64(uint64_t a, uint64_t b, uint64_t p) {
+#ifdef _MSC_VER
+  uint64_t hi;
+  uint64_t lo = _umul128(a, b, &hi);
+  uint64_t r;
+  _udiv128(hi % p, lo, p, &r);
+  return r;
+#else
+  return uint64_t((__uint128_t)a * b % p);
+#endif
+}
+
+uint64_t naive_powmod_u64(uint64_t a, uint64_t e, uint64_t p) {
+  uint64_t result = 1;
+  a %= p;
+  while (e != 0) {
+    if (e & 1)
+      result = naive_mulmod_u64(result, a, p);
+    a = naive_mulmod_u64(a, a, p);
+    e >>= 1;
+  }
+  return result;
+}
+
+bool naive_is_prime_u64(uint64_t n) {
+  if (n <= UINT32_MAX)
+    return naive_is_prime_u32(uint32_t(n));
+  if ((n & 1) == 0)
+    return false;
+  uint64_t odd = n - 1;
+  int s = 0;
+  while ((odd & 1) == 0) {
+    odd >>= 1;
+    s++;
+  }
+  for (uint64_t base : {2, 325, 9375, 28178, 450775, 9780504, 1795265022}) {
+    uint64_t x = naive_powmod_u64(base, odd, n);
+    if ((x == 1) || (x == n - 1))
+      continue;
+    int j = 1;
+    for (; j < s; j++) {
+      x = naive_mulmod_u64(x, x, n);
+      if (x == n - 1)
+        break;
+    }
+    if (j == s)
+      return false;
+  }
+  return true;
+}
+
+template <typename T, typename F>
+uint64_t time(const F &is_prime, T start, T count, size_t &primes) {
+  counters().start();
+  auto begin = std::chrono::high_resolution_clock::now();
+  primes = 0;
+  for (T n = start; n != start + count; n++) {
+    primes += is_prime(n);
+  }
+  doNotOptimizeAway(primes);
+  auto end = std::chrono::high_resolution_clock::now();
+  event_count counts = counters().end();
+  auto diff = end - begin;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
+  std::fprintf(stderr, "Time: %zu\n", size_t(ns));
+  print_counters(counts, size_t(count));
+  return ns;
+}
+
+int main() {
+  const uint32_t start32 = UINT32_C(0x80000000);
+  const uint32_t count32 = 1000000;
+  size_t fastprimes, naiveprimes;
+  std::cout << "counting 32-bit primes with is_prime_u32 " << std::endl;
+  auto fasttime = time<uint32_t>([](uint32_t n) { return is_prime_u32(n); },
+                                 start32, count32, fastprimes);
+  std::cout << "counting 32-bit primes with hardware division " << std::endl;
+  auto naivetime =
+      time<uint32_t>([](uint32_t n) { return naive_is_prime_u32(n); }, start32,
+                     count32, naiveprimes);
+  if (fastprimes != naiveprimes) {
+    std::fprintf(stderr, "mismatch: %zu primes vs %zu\n", fastprimes,
+                 naiveprimes);
+    return EXIT_FAILURE;
+  }
+  std::fprintf(stderr,
+               "%zu primes in [%u, %u), is_prime_u32 is %lf as fast as the "
+               "naive test\n",
+               fastprimes, start32, start32 + count32,
+               (double)naivetime / fasttime);
+
+  const uint64_t start64 = UINT64_C(0x4000000000000000);
+  const uint64_t count64 = 200000;
+  std::cout << "counting 64-bit primes with is_prime_u64 " << std::endl;
+  fasttime = time<uint64_t>([](uint64_t n) { return is_prime_u64(n); },
+                            start64, count64, fastprimes);
+  std::cout << "counting 64-bit primes with hardware division " << std::endl;
+  naivetime = time<uint64_t>([](uint64_t n) { return naive_is_prime_u64(n); },
+                             start64, count64, naiveprimes);
+  if (fastprimes != naiveprimes) {
+    std::fprintf(stderr, "mismatch: %zu primes vs %zu\n", fastprimes,
+                 naiveprimes);
+    return EXIT_FAILURE;
+  }
+  std::fprintf(stderr,
+               "%zu primes in [2^62, 2^62 + %zu), is_prime_u64 is %lf as fast "
+               "as the naive test\n",
+               fastprimes, size_t(count64), (double)naivetime / fasttime);
+}
@@ -0,0 +1,137 @@
+// The cost of computing the magic numbers, for when the divisors change
+// often.
+//
+// Usage: setupbenchmark [divisors]
+//
+// We compute M for the same divisors many times (thousands of them, so
+// that they stay in cache) and report the nanoseconds per divisor, for
+// small divisors (below 2^16) and for divisors over the whole range, with
+// 32-bit and then 64-bit divisors.
+#include "fastmod_dispatch.h"
+#include "performancecounters.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+
+// best of a few runs, in nanoseconds per divisor
+template <typename F, typename D, typename R>
+double time(const F &x, const std::vector<D> &d, std::vector<R> &M) {
+  const size_t repeat = (size_t(1) << 24) / d.size() + 1;
+  double best = 1e300;
+  for (int r = 0; r < 3; r++) {
+    counters().start();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t k = 0; k < repeat; k++) {
+      x(d.data(), M.data(), d.size());
+      doNotOptimizeAway(M.back());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    event_count counts = counters().end();
+    double ns =
+        double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                   .count()) /
+        double(repeat * d.size());
+    if (ns < best)
+      best = ns;
+    if (r == 0)
+      print_counters(counts, repeat * d.size());
+  }
+  return best;
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = 4096;
+  if (argc > 1)
+    n = size_t(strtoull(argv[1], NULL, 10));
+  if (n == 0) {
+    std::fprintf(stderr, "usage: %s [divisors]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::mt19937_64 mt;
+  std::vector<uint32_t> small(n), large(n);
+  std::vector<uint64_t> small64(n), large64(n);
+  for (size_t i = 0; i < n; i++) {
+    small[i] = uint32_t(mt() % 0xFFFF) + 1;
+    large[i] = uint32_t(mt() % 0xFFFFFFFF) + 1;
+    small64[i] = small[i];
+    large64[i] = mt() | 1;
+  }
+  std::vector<uint64_t> M(n);
+  std::printf("%zu divisors, dispatch kernel %s\n", n,
+              fastmod_dispatch_name());
+  std::printf("%-32s %14s %14s\n", "", "small ns/d", "large ns/d");
+  struct {
+    const char *name;
+    void (*f)(const uint32_t *, uint64_t *, size_t);
+  } const cases[] = {
+      {"computeM_u32",
+       [](const uint32_t *d, uint64_t *out, size_t count) {
+         for (size_t i = 0; i < count; i++)
+           out[i] = computeM_u32(d[i]);
+       }},
+      {"computeM_u32_nodiv",
+       [](const uint32_t *d, uint64_t *out, size_t count) {
+         for (size_t i = 0; i < count; i++)
+           out[i] = computeM_u32_nodiv(d[i]);
+       }},
+      {"computeM_u32_batch", computeM_u32_batch},
+      {"computeM_u32_batch_dispatch", computeM_u32_batch_dispatch},
+  };
+  for (const auto &c : cases) {
+    double s = time(c.f, small, M);
+    double l = time(c.f, large, M);
+    std::printf("%-32s %14.3f %14.3f\n", c.name, s, l);
+  }
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+  std::vector<fastmod_u128_t> M64(n);
+  struct {
+    const char *name;
+    void (*f)(const uint64_t *, fastmod_u128_t *, size_t);
+  } const cases64[] = {
+      {"computeM_u64",
+       [](const uint64_t *d, fastmod_u128_t *out, size_t count) {
+         for (size_t i = 0; i < count; i++)
+           out[i] = computeM_u64(d[i]);
+       }},
+#ifndef _MSC_VER
+      {"computeM_u64_nodiv",
+       [](const uint64_t *d, fastmod_u128_t *out, size_t count) {
+         for (size_t i = 0; i < count; i++)
+           out[i] = computeM_u64_nodiv(d[i]);
+       }},
+#endif
+  };
+  for (const auto &c : cases64) {
+    double s = time(c.f, small64, M64);
+    double l = time(c.f, large64, M64);
+    std::printf("%-32s %14.3f %14.3f\n", c.name, s, l);
+  }
+#endif
+  return EXIT_SUCCESS;
+}
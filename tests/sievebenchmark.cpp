@@ -0,0 +1,159 @@
+#include "fastmod_batch.h"
+#include "performancecounters.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+template <typename F>
+uint64_t time(const F &x, std::vector<uint64_t> &bits, size_t repeat) {
+  counters().start();
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t r = 0; r < repeat; r++)
+    x(bits.data());
+  doNotOptimizeAway(bits.back());
+  auto end = std::chrono::high_resolution_clock::now();
+  event_count counts = counters().end();
+  auto diff = end - start;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
+  std::fprintf(stderr, "Time: %zu\n", size_t(ns));
+  print_counters(counts, bits.size() * 64 * repeat);
+  return ns;
+}
+
+size_t popcount(const std::vector<uint64_t> &bits) {
+  size_t count = 0;
+  for (uint64_t word : bits) {
+    for (; word != 0; word &= word - 1)
+      count++;
+  }
+  return count;
+}
+
+int main() {
+  std::mt19937_64 mt;
+  // small enough to stay in cache, we run over it many times
+  std::vector<uint32_t> zomg(100000);
+  for (auto &e : zomg)
+    e = uint32_t(mt());
+  std::vector<uint64_t> bits((zomg.size() + 63) / 64);
+
+  const uint32_t mod = uint32_t(3 + mt() % 30);
+  const uint64_t M = computeM_u32(mod);
+  std::cout << "timing is_divisible (one at a time)" << std::endl;
+  auto idtime = time(
+      [&zomg, M](uint64_t *b) {
+        is_divisible_u32_batch_scalar(zomg.data(), b, zomg.size(), M);
+      },
+      bits, 100);
+  size_t expected = popcount(bits);
+  std::cout << "timing is_divisible_u32_batch" << std::endl;
+  auto idbtime = time(
+      [&zomg, M](uint64_t *b) {
+        is_divisible_u32_batch(zomg.data(), b, zomg.size(), M);
+      },
+      bits, 100);
+  if (popcount(bits) != expected) {
+    std::fprintf(stderr, "mismatch in is_divisible_u32_batch\n");
+    return EXIT_FAILURE;
+  }
+  std::cout << "timing x modulo mod == 0; " << std::endl;
+  auto modtime = time(
+      [&zomg, mod](uint64_t *b) {
+        for (size_t i = 0; i < zomg.size(); i += 64) {
+          size_t end = zomg.size() - i < 64 ? zomg.size() - i : 64;
+          uint64_t word = 0;
+          for (size_t j = 0; j < end; j++) {
+            word |= uint64_t(zomg[i + j] % mod == 0) << j;
+          }
+          b[i / 64] = word;
+        }
+      },
+      bits, 100);
+  std::fprintf(stderr,
+               "is_divisible_u32_batch is %lf as fast as is_divisible and %lf "
+               "as fast as modding\n",
+               (double)idtime / idbtime, (double)modtime / idbtime);
+
+  // sieve the segment [start, start + n) with the primes below 2^16
+  std::vector<uint32_t> primes;
+  std::vector<uint64_t> Ms;
+  for (uint32_t p = 2; p < 0x10000; p++) {
+    if (is_prime_u32(p)) {
+      primes.push_back(p);
+      Ms.push_back(computeM_u32(p));
+    }
+  }
+  const uint32_t start = UINT32_C(0x80000000);
+  const size_t n = 1 << 16;
+  bits.assign((n + 63) / 64, 0);
+  std::cout << "timing sieve_u32_segment with " << primes.size() << " primes"
+            << std::endl;
+  auto sievetime = time(
+      [&Ms, start, n](uint64_t *b) {
+        sieve_u32_segment(start, b, n, Ms.data(), Ms.size());
+      },
+      bits, 1);
+  size_t composites = popcount(bits);
+  std::cout << "timing the same sieve with is_divisible (one at a time)"
+            << std::endl;
+  auto scalartime = time(
+      [&Ms, start, n](uint64_t *b) {
+        for (size_t i = 0; i < (n + 63) / 64; i++)
+          b[i] = 0;
+        for (uint64_t pM : Ms)
+          mark_divisible_u32_range_scalar(start, b, n, pM);
+      },
+      bits, 1);
+  if (popcount(bits) != composites) {
+    std::fprintf(stderr, "mismatch in the scalar sieve\n");
+    return EXIT_FAILURE;
+  }
+  std::cout << "timing the same sieve with x modulo p == 0; " << std::endl;
+  auto sievemodtime = time(
+      [&primes, start, n](uint64_t *b) {
+        for (size_t i = 0; i < (n + 63) / 64; i++)
+          b[i] = 0;
+        for (uint32_t p : primes) {
+          for (size_t j = 0; j < n; j++) {
+            b[j / 64] |= uint64_t((start + uint32_t(j)) % p == 0) << (j % 64);
+          }
+        }
+      },
+      bits, 1);
+  if (popcount(bits) != composites) {
+    std::fprintf(stderr, "mismatch in the modding sieve\n");
+    return EXIT_FAILURE;
+  }
+  std::fprintf(stderr,
+               "%zu primes in [%u, %u), sieve_u32_segment is %lf as fast as "
+               "is_divisible and %lf as fast as modding\n",
+               n - composites, start, start + uint32_t(n),
+               (double)scalartime / sievetime,
+               (double)sievemodtime / sievetime);
+}
@@ -0,0 +1,425 @@
+// Benchmark suite for the scalar functions: every API (u32, s32, u64, s64)
+// and operation (mod, div, is_divisible) against the native operators, for
+// several classes of divisors, in throughput and in latency mode.
+//
+// Usage: suitebenchmark [--csv | --json] [--throughput | --latency]
+//                       [--n count] [--repeat count] [--filter text]
+//
+// In throughput mode, the operations are independent so that the processor
+// can overlap them. In latency mode, each dividend depends on the previous
+// result (x = f(in[i] ^ x)), so that we measure the length of the dependency
+// chain; the xor adds one cycle to every implementation.
+//
+// The implementations are
+//   fastmod        precomputed M with a divisor unknown to the compiler,
+//   native         the % and / operators with a divisor unknown to the
+//                  compiler (a hardware division),
+//   fastmod_const  the fastmod<d> and fastdiv<d> templates,
+//   native_const   the % and / operators with a constant divisor (the
+//                  compiler replaces the division).
+// On x86, cycles are measured with the time-stamp counter (rdtsc), whose
+// frequency is the nominal frequency of the processor, not the current one.
+// Under Linux, when the hardware performance counters are available, the
+// core cycles, instructions, IPC and branch misses per operation are also
+// reported (see performancecounters.h).
+#include "fastmod.h"
+#include "performancecounters.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) ||            \
+    defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define FASTMOD_BENCH_RDTSC 1
+#endif
+
+#ifdef _MSC_VER
+
+// Taken from Facebook's folly
+// https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L270-L284
+#pragma optimize("", off)
+inline void doNotOptimizeDependencySink(const void*) {}
+
+#pragma optimize("", on)
+template <class T>
+void doNotOptimizeAway(const T& datum) {
+    doNotOptimizeDependencySink(&datum);
+}
+#else
+
+template <typename T> inline void doNotOptimizeAway(T &&datum) {
+  // Taken from Facebook's folly
+  // https://github.com/facebook/folly/blob/0f6bc7a3f0133bd49226b50026de60e708900577/folly/Benchmark.h#L318-L326
+  asm volatile("" ::"m"(datum) : "memory");
+}
+
+#endif
+
+using namespace fastmod;
+
+// hides a value from the optimizer so that the divisor is only known at
+// runtime
+template <typename T> T opaque(T x) {
+  volatile T v = x;
+  return v;
+}
+
+inline uint64_t cycles() {
+#ifdef FASTMOD_BENCH_RDTSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+struct config {
+  enum { text, csv, json } format = text;
+  bool throughput = true;
+  bool latency = true;
+  size_t n = 1 << 18;
+  size_t repeat = 5;
+  const char *filter = "";
+};
+
+struct result {
+  std::string api, op, divisor_class, divisor, impl, mode;
+  double ns_per_op;
+  double ops_per_cycle; // 0 when there is no cycle counter
+  event_count counts;   // of the fastest run, counts.valid may be false
+  size_t ops;
+
+  double cycles_per_op() const { return double(counts.cycles) / double(ops); }
+  double instructions_per_op() const {
+    return double(counts.instructions) / double(ops);
+  }
+  double ipc() const {
+    return counts.cycles == 0
+               ? 0
+               : double(counts.instructions) / double(counts.cycles);
+  }
+  double branch_misses_per_op() const {
+    return double(counts.branch_misses) / double(ops);
+  }
+};
+
+struct suite {
+  config conf;
+  std::vector<result> results;
+
+  // f maps a dividend to a result of the same type
+  template <typename T, typename F>
+  void run(const char *api, const char *op, const char *divisor_class,
+           const std::string &divisor, const char *impl,
+           const std::vector<T> &in, F f) {
+    std::string name = std::string(api) + "/" + op + "/" + divisor_class +
+                       "/" + impl;
+    if (name.find(conf.filter) == std::string::npos)
+      return;
+    for (int latency = 0; latency < 2; latency++) {
+      if (latency ? !conf.latency : !conf.throughput)
+        continue;
+      uint64_t best_ns = UINT64_MAX;
+      uint64_t best_cycles = UINT64_MAX;
+      event_count best_counts;
+      for (size_t r = 0; r < conf.repeat; r++) {
+        counters().start();
+        auto start = std::chrono::steady_clock::now();
+        uint64_t start_cycles = cycles();
+        if (latency) {
+          T x = 0;
+          for (const T e : in) {
+            x = f(T(e ^ x));
+          }
+          doNotOptimizeAway(x);
+        } else {
+          for (const T e : in) {
+            doNotOptimizeAway(f(e));
+          }
+        }
+        uint64_t end_cycles = cycles();
+        auto end = std::chrono::steady_clock::now();
+        event_count counts = counters().end();
+        uint64_t ns = uint64_t(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                .count());
+        if (ns < best_ns) {
+          best_ns = ns;
+          best_counts = counts;
+        }
+        if (end_cycles - start_cycles < best_cycles)
+          best_cycles = end_cycles - start_cycles;
+      }
+      result res;
+      res.api = api;
+      res.op = op;
+      res.divisor_class = divisor_class;
+      res.divisor = divisor;
+      res.impl = impl;
+      res.mode = latency ? "latency" : "throughput";
+      res.ns_per_op = double(best_ns) / double(in.size());
+      res.ops_per_cycle =
+          best_cycles == 0 ? 0 : double(in.size()) / double(best_cycles);
+      res.counts = best_counts;
+      res.ops = in.size();
+      results.push_back(res);
+    }
+  }
+
+  void print() const {
+    if (conf.format == config::csv) {
+      std::printf("api,op,class,divisor,impl,mode,ns_per_op,ops_per_cycle,"
+                  "cycles_per_op,instructions_per_op,ipc,"
+                  "branch_misses_per_op\n");
+      for (const result &r : results) {
+        std::printf("%s,%s,%s,%s,%s,%s,%.4f,", r.api.c_str(), r.op.c_str(),
+                    r.divisor_class.c_str(), r.divisor.c_str(),
+                    r.impl.c_str(), r.mode.c_str(), r.ns_per_op);
+        if (r.ops_per_cycle > 0)
+          std::printf("%.4f", r.ops_per_cycle);
+        if (r.counts.valid)
+          std::printf(",%.4f,%.4f,%.4f,%.6f", r.cycles_per_op(),
+                      r.instructions_per_op(), r.ipc(),
+                      r.branch_misses_per_op());
+        else
+          std::printf(",,,,");
+        std::printf("\n");
+      }
+    } else if (conf.format == config::json) {
+      std::printf("[\n");
+      for (size_t i = 0; i < results.size(); i++) {
+        const result &r = results[i];
+        std::printf("  {\"api\": \"%s\", \"op\": \"%s\", \"class\": \"%s\", "
+                    "\"divisor\": \"%s\", \"impl\": \"%s\", \"mode\": \"%s\", "
+                    "\"ns_per_op\": %.4f, \"ops_per_cycle\": ",
+                    r.api.c_str(), r.op.c_str(), r.divisor_class.c_str(),
+                    r.divisor.c_str(), r.impl.c_str(), r.mode.c_str(),
+                    r.ns_per_op);
+        if (r.ops_per_cycle > 0)
+          std::printf("%.4f", r.ops_per_cycle);
+        else
+          std::printf("null");
+        if (r.counts.valid)
+          std::printf(", \"cycles_per_op\": %.4f, \"instructions_per_op\": "
+                      "%.4f, \"ipc\": %.4f, \"branch_misses_per_op\": %.6f}",
+                      r.cycles_per_op(), r.instructions_per_op(), r.ipc(),
+                      r.branch_misses_per_op());
+        else
+          std::printf(", \"cycles_per_op\": null, \"instructions_per_op\": "
+                      "null, \"ipc\": null, \"branch_misses_per_op\": null}");
+        std::printf("%s\n", i + 1 < results.size() ? "," : "");
+      }
+      std::printf("]\n");
+    } else {
+      std::printf("%-4s %-13s %-6s %-21s %-14s %-10s %10s %13s", "api", "op",
+                  "class", "divisor", "impl", "mode", "ns/op", "ops/cycle");
+      if (counters().has_events())
+        std::printf(" %10s %10s %7s %12s", "cycles/op", "ins/op", "IPC",
+                    "brmisses/op");
+      std::printf("\n");
+      for (const result &r : results) {
+        std::printf("%-4s %-13s %-6s %-21s %-14s %-10s %10.3f %13.3f",
+                    r.api.c_str(), r.op.c_str(), r.divisor_class.c_str(),
+                    r.divisor.c_str(), r.impl.c_str(), r.mode.c_str(),
+                    r.ns_per_op, r.ops_per_cycle);
+        if (r.counts.valid)
+          std::printf(" %10.3f %10.3f %7.3f %12.5f", r.cycles_per_op(),
+                      r.instructions_per_op(), r.ipc(),
+                      r.branch_misses_per_op());
+        std::printf("\n");
+      }
+    }
+  }
+};
+
+template <typename T> std::vector<T> dividends(size_t n) {
+  std::mt19937_64 mt;
+  std::vector<T> values(n);
+  for (auto &e : values)
+    e = T(mt());
+  return values;
+}
+
+template <uint32_t d>
+void bench_u32(suite &s, const char *divisor_class,
+               const std::vector<uint32_t> &in) {
+  const uint32_t rd = opaque(d);
+  const uint64_t M = computeM_u32(rd);
+  const std::string ds = std::to_string(d);
+  s.run("u32", "mod", divisor_class, ds, "fastmod", in,
+        [M, rd](uint32_t x) { return fastmod_u32(x, M, rd); });
+  s.run("u32", "mod", divisor_class, ds, "native", in,
+        [rd](uint32_t x) { return x % rd; });
+  s.run("u32", "mod", divisor_class, ds, "fastmod_const", in,
+        [](uint32_t x) { return fastmod::fastmod<d>(x); });
+  s.run("u32", "mod", divisor_class, ds, "native_const", in,
+        [](uint32_t x) { return x % d; });
+  s.run("u32", "div", divisor_class, ds, "fastmod", in,
+        [M](uint32_t x) { return fastdiv_u32(x, M); });
+  s.run("u32", "div", divisor_class, ds, "native", in,
+        [rd](uint32_t x) { return x / rd; });
+  s.run("u32", "div", divisor_class, ds, "fastmod_const", in,
+        [](uint32_t x) { return fastmod::fastdiv<d>(x); });
+  s.run("u32", "div", divisor_class, ds, "native_const", in,
+        [](uint32_t x) { return x / d; });
+  s.run("u32", "is_divisible", divisor_class, ds, "fastmod", in,
+        [M](uint32_t x) { return uint32_t(is_divisible(x, M)); });
+  s.run("u32", "is_divisible", divisor_class, ds, "native", in,
+        [rd](uint32_t x) { return uint32_t(x % rd == 0); });
+  s.run("u32", "is_divisible", divisor_class, ds, "fastmod_const", in,
+        [](uint32_t x) { return uint32_t(is_divisible(x, computeM_u32(d))); });
+  s.run("u32", "is_divisible", divisor_class, ds, "native_const", in,
+        [](uint32_t x) { return uint32_t(x % d == 0); });
+}
+
+template <int32_t d>
+void bench_s32(suite &s, const char *divisor_class,
+               const std::vector<uint32_t> &in) {
+  const int32_t rd = opaque(d);
+  const uint64_t M = computeM_s32(rd);
+  const std::string ds = std::to_string(d);
+  // the dividends are unsigned so that the latency chain can use a xor
+  s.run("s32", "mod", divisor_class, ds, "fastmod", in, [M, rd](uint32_t x) {
+    return uint32_t(fastmod_s32(int32_t(x), M, rd));
+  });
+  s.run("s32", "mod", divisor_class, ds, "native", in,
+        [rd](uint32_t x) { return uint32_t(int32_t(x) % rd); });
+  s.run("s32", "mod", divisor_class, ds, "fastmod_const", in,
+        [](uint32_t x) { return uint32_t(fastmod::fastmod<d>(int32_t(x))); });
+  s.run("s32", "mod", divisor_class, ds, "native_const", in,
+        [](uint32_t x) { return uint32_t(int32_t(x) % d); });
+  s.run("s32", "div", divisor_class, ds, "fastmod", in, [M, rd](uint32_t x) {
+    return uint32_t(fastdiv_s32(int32_t(x), M, rd));
+  });
+  s.run("s32", "div", divisor_class, ds, "native", in,
+        [rd](uint32_t x) { return uint32_t(int32_t(x) / rd); });
+  s.run("s32", "div", divisor_class, ds, "fastmod_const", in,
+        [](uint32_t x) { return uint32_t(fastmod::fastdiv<d>(int32_t(x))); });
+  s.run("s32", "div", divisor_class, ds, "native_const", in,
+        [](uint32_t x) { return uint32_t(int32_t(x) / d); });
+}
+
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+template <uint64_t d>
+void bench_u64(suite &s, const char *divisor_class,
+               const std::vector<uint64_t> &in) {
+  const uint64_t rd = opaque(d);
+  const fastmod_u128_t M = computeM_u64(rd);
+  const std::string ds = std::to_string(d);
+  s.run("u64", "mod", divisor_class, ds, "fastmod", in,
+        [M, rd](uint64_t x) { return fastmod_u64(x, M, rd); });
+  s.run("u64", "mod", divisor_class, ds, "native", in,
+        [rd](uint64_t x) { return x % rd; });
+  s.run("u64", "mod", divisor_class, ds, "fastmod_const", in,
+        [](uint64_t x) { return fastmod::fastmod<d>(x); });
+  s.run("u64", "mod", divisor_class, ds, "native_const", in,
+        [](uint64_t x) { return x % d; });
+  s.run("u64", "div", divisor_class, ds, "fastmod", in,
+        [M](uint64_t x) { return fastdiv_u64(x, M); });
+  s.run("u64", "div", divisor_class, ds, "native", in,
+        [rd](uint64_t x) { return x / rd; });
+  s.run("u64", "div", divisor_class, ds, "fastmod_const", in,
+        [](uint64_t x) { return fastmod::fastdiv<d>(x); });
+  s.run("u64", "div", divisor_class, ds, "native_const", in,
+        [](uint64_t x) { return x / d; });
+  s.run("u64", "is_divisible", divisor_class, ds, "fastmod", in,
+        [M](uint64_t x) { return uint64_t(is_divisible_u64(x, M)); });
+  s.run("u64", "is_divisible", divisor_class, ds, "native", in,
+        [rd](uint64_t x) { return uint64_t(x % rd == 0); });
+  s.run("u64", "is_divisible", divisor_class, ds, "fastmod_const", in,
+        [](uint64_t x) {
+          return uint64_t(is_divisible_u64(x, computeM_u64(d)));
+        });
+  s.run("u64", "is_divisible", divisor_class, ds, "native_const", in,
+        [](uint64_t x) { return uint64_t(x % d == 0); });
+}
+
+template <int64_t d>
+void bench_s64(suite &s, const char *divisor_class,
+               const std::vector<uint64_t> &in) {
+  const int64_t rd = opaque(d);
+  const fastmod_u128_t M = computeM_s64(rd);
+  const std::string ds = std::to_string(d);
+  s.run("s64", "mod", divisor_class, ds, "fastmod", in, [M, rd](uint64_t x) {
+    return uint64_t(fastmod_s64(int64_t(x), M, rd));
+  });
+  s.run("s64", "mod", divisor_class, ds, "native", in,
+        [rd](uint64_t x) { return uint64_t(int64_t(x) % rd); });
+  s.run("s64", "mod", divisor_class, ds, "fastmod_const", in,
+        [](uint64_t x) { return uint64_t(fastmod::fastmod<d>(int64_t(x))); });
+  s.run("s64", "mod", divisor_class, ds, "native_const", in,
+        [](uint64_t x) { return uint64_t(int64_t(x) % d); });
+  s.run("s64", "div", divisor_class, ds, "fastmod", in, [M, rd](uint64_t x) {
+    return uint64_t(fastdiv_s64(int64_t(x), M, rd));
+  });
+  s.run("s64", "div", divisor_class, ds, "native", in,
+        [rd](uint64_t x) { return uint64_t(int64_t(x) / rd); });
+  s.run("s64", "div", divisor_class, ds, "fastmod_const", in,
+        [](uint64_t x) { return uint64_t(fastmod::fastdiv<d>(int64_t(x))); });
+  s.run("s64", "div", divisor_class, ds, "native_const", in,
+        [](uint64_t x) { return uint64_t(int64_t(x) / d); });
+}
+#endif
+
+int main(int argc, char *argv[]) {
+  suite s;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--csv") == 0) {
+      s.conf.format = config::csv;
+    } else if (strcmp(argv[i], "--json") == 0) {
+      s.conf.format = config::json;
+    } else if (strcmp(argv[i], "--throughput") == 0) {
+      s.conf.latency = false;
+    } else if (strcmp(argv[i], "--latency") == 0) {
+      s.conf.throughput = false;
+    } else if (strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
+      s.conf.n = size_t(strtoull(argv[++i], NULL, 10));
+    } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      s.conf.repeat = size_t(strtoull(argv[++i], NULL, 10));
+    } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      s.conf.filter = argv[++i];
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--csv | --json] [--throughput | --latency] "
+                   "[--n count] [--repeat count] [--filter text]\n",
+                   argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (s.conf.n == 0 || s.conf.repeat == 0) {
+    std::fprintf(stderr, "--n and --repeat must be positive\n");
+    return EXIT_FAILURE;
+  }
+  const std::vector<uint32_t> in32 = dividends<uint32_t>(s.conf.n);
+  // pow2 is a power of two, small is a small composite number, prime is a
+  // prime of medium size and large is the largest prime of the type
+  bench_u32<1024>(s, "pow2", in32);
+  bench_u32<10>(s, "small", in32);
+  bench_u32<1000003>(s, "prime", in32);
+  bench_u32<4294967291u>(s, "large", in32);
+  bench_s32<1024>(s, "pow2", in32);
+  bench_s32<10>(s, "small", in32);
+  bench_s32<1000003>(s, "prime", in32);
+  bench_s32<2147483647>(s, "large", in32);
+#if !defined(_MSC_VER) || (defined(_M_AMD64) && (_MSC_VER >= 1923))
+  const std::vector<uint64_t> in64 = dividends<uint64_t>(s.conf.n);
+  bench_u64<1024>(s, "pow2", in64);
+  bench_u64<10>(s, "small", in64);
+  bench_u64<1000003>(s, "prime", in64);
+  bench_u64<UINT64_C(18446744073709551557)>(s, "large", in64);
+  bench_s64<1024>(s, "pow2", in64);
+  bench_s64<10>(s, "small", in64);
+  bench_s64<1000003>(s, "prime", in64);
+  bench_s64<INT64_C(9223372036854775783)>(s, "large", in64);
+#endif
+  s.print();
+  return EXIT_SUCCESS;
+}
@@ -6,6 +6,8 @@
 #include <string.h>
 
 #include "fastmod.h"
+#include "fastmod_batch.h"
+#include "fastmod_dispatch.h"
 #ifdef __cplusplus
 using namespace fastmod;
 #endif
@@ -127,8 +129,9 @@ bool testdivunsigned(uint32_t min, uint32_t max, bool verbose) {
 }
 
 bool testsigned(int32_t min, int32_t max, bool verbose) {
-  assert(min != max + 1); // infinite loop!
-  for (int32_t d = min; (d <= max) && (d >= min); d++) {
+  // d++ would overflow at INT32_MAX, the counter has 64 bits
+  for (int64_t d64 = min; d64 <= max; d64++) {
+    const int32_t d = (int32_t)d64;
     if (d == 0) {
       printf("skipping d = 0 as it cannot be supported\n");
       continue;
@@ -170,8 +173,9 @@ bool testsigned(int32_t min, int32_t max, bool verbose) {
 }
 
 bool testdivsigned(int32_t min, int32_t max, bool verbose) {
-  assert(min != max + 1); // infinite loop!
-  for (int32_t d = min; (d <= max) && (d >= min); d++) {
+  // d++ would overflow at INT32_MAX, the counter has 64 bits
+  for (int64_t d64 = min; d64 <= max; d64++) {
+    const int32_t d = (int32_t)d64;
     if (d == 0) {
       printf("skipping d = 0\n");
       continue;
@@ -217,6 +221,902 @@ bool testdivsigned(int32_t min, int32_t max, bool verbose) {
   return true;
 }
 
+bool testdivmod(uint32_t min, uint32_t max, bool verbose) {
+  // dividends are checked in windows around every fourth power of two and
+  // at the top of the range; for each d, the signed functions use d and -d
+  // and the 64-bit functions use d shifted to the top of the word
+  const uint32_t window = 0x1000;
+  for (uint32_t d = min; (d <= max) && (d >= min); d++) {
+    if (d < 2) {
+      printf("skipping d = %u as fastdivmod does not support it\n", d);
+      continue;
+    }
+    if (verbose)
+      printf("d = %u (fastdivmod) ", d);
+    else
+      printf(".");
+    fflush(NULL);
+    uint64_t M = computeM_u32(d);
+    int32_t sd = (int32_t)(d & 0x7fffffff);
+    uint64_t d64 = (uint64_t)d << 31;
+    __uint128_t M64 = computeM_u64(d64);
+    uint64_t Ms[2] = {0, 0};
+    if (sd >= 2) {
+      Ms[0] = computeM_s32(-sd);
+      Ms[1] = computeM_s32(sd);
+    }
+    for (int shift = 0; shift <= 64; shift += 4) {
+      uint64_t start = UINT64_MAX - window + 1;
+      if (shift < 64) {
+        uint64_t center = UINT64_C(1) << shift;
+        start = center > window / 2 ? center - window / 2 : 0;
+      }
+      for (uint64_t i = 0; i < window; i++) {
+        uint64_t a64 = start + i;
+        uint32_t a = (uint32_t)a64;
+        uint32_t r;
+        uint32_t q = fastdivmod_u32(a, M, d, &r);
+        if ((q != a / d) || (r != a % d)) {
+          printf("(bad fastdivmod_u32) problem with divisor %u and dividend "
+                 "%u \n",
+                 d, a);
+          return false;
+        }
+        uint64_t r64;
+        uint64_t q64 = fastdivmod_u64(a64, M64, d64, &r64);
+        if ((q64 != a64 / d64) || (r64 != a64 % d64)) {
+          printf("(bad fastdivmod_u64) problem with divisor %" PRIu64
+                 " and dividend %" PRIu64 " \n",
+                 d64, a64);
+          return false;
+        }
+        if (sd < 2)
+          continue;
+        for (int sign = -1; sign <= 1; sign += 2) {
+          int32_t signed_d = sign * sd;
+          int32_t sa = (int32_t)a;
+          int32_t sr;
+          int32_t sq = fastdivmod_s32(sa, Ms[sign > 0], signed_d, &sr);
+          if ((sq != sa / signed_d) || (sr != sa % signed_d)) {
+            printf("(bad fastdivmod_s32) problem with divisor %d and "
+                   "dividend %d \n",
+                   signed_d, sa);
+            return false;
+          }
+        }
+      }
+    }
+    if (verbose)
+      printf("ok!\n");
+  }
+  if (verbose)
+    printf("fastdivmod test passed with divisors in interval [%u, %u].\n",
+           min, max);
+  return true;
+}
+
+bool testfastrange(uint32_t min, uint32_t max, bool verbose) {
+  for (uint32_t d = min; (d <= max) && (d >= min); d++) {
+    if (d == 0) {
+      printf("skipping d = 0 as the range would be empty\n");
+      continue;
+    }
+    if (verbose)
+      printf("d = %u (fastrange) ", d);
+    else
+      printf(".");
+    fflush(NULL);
+    // the smallest and the largest inputs reach both ends of the range
+    if ((fastrange32(0, d) != 0) || (fastrange32(UINT32_MAX, d) != d - 1) ||
+        (fastrange64(0, d) != 0) || (fastrange64(UINT64_MAX, d) != d - 1)) {
+      printf("(bad fastrange) range ends are wrong for %u\n", d);
+      return false;
+    }
+    uint64_t x = d;
+    uint32_t previous = 0;
+    for (int i = 0; i < 0x1000; i++) {
+      x = x * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+      uint32_t x32 = (uint32_t)(x >> 32);
+      uint32_t r32 = fastrange32(x32, d);
+      uint64_t r64 = fastrange64(x, d);
+      // a sweep over consecutive inputs never goes down
+      uint32_t next = fastrange32((uint32_t)i << 20, d);
+      if ((r32 >= d) || (r64 >= d) ||
+          (r64 != (((x >> 32) * d + (((x & UINT32_MAX) * d) >> 32)) >> 32)) ||
+          (next < previous)) {
+        printf("(bad fastrange) problem with d = %u and x = %" PRIu64 "\n", d,
+               x);
+        return false;
+      }
+      previous = next;
+    }
+    if (verbose)
+      printf("ok!\n");
+  }
+  if (verbose)
+    printf("fastrange test passed with d in interval [%u, %u].\n", min, max);
+  return true;
+}
+
+bool testmulmod(uint32_t min, uint32_t max, bool verbose) {
+  for (uint32_t p = min; (p <= max) && (p >= min); p++) {
+    if (p < 2) {
+      printf("skipping p = %u as mulmod does not support it\n", p);
+      continue;
+    }
+    if (verbose)
+      printf("p = %u (mulmod) ", p);
+    else
+      printf(".");
+    fflush(NULL);
+    uint64_t M = computeM_u32(p);
+    // b takes the extreme values first, then pseudo-random ones
+    const uint32_t bs[] = {0, 1, p - 1, p / 2, UINT32_MAX};
+    uint64_t x = p;
+    for (int j = 0; j < 64; j++) {
+      uint32_t b;
+      if (j < (int)(sizeof(bs) / sizeof(bs[0]))) {
+        b = bs[j];
+      } else {
+        x = x * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+        b = (uint32_t)(x >> 32);
+      }
+      uint32_t breduced = b % p;
+      uint32_t bM = computeM_mulmod_u32(breduced, M, p);
+      for (int i = 0; i < 0x400; i++) {
+        x = x * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+        uint32_t a = (uint32_t)(x >> 32);
+        if (i < 2)
+          a = i == 0 ? UINT32_MAX : p - 1;
+        uint32_t expected = (uint32_t)(((uint64_t)a * b) % p);
+        uint32_t computed = mulmod_u32(a, b, M, p);
+        uint32_t precomp = mulmod_precomp_u32(a, breduced, bM, p);
+        if ((computed != expected) || (precomp != expected)) {
+          printf("(bad mulmod) problem with modulus %u and factors %u %u\n",
+                 p, a, b);
+          printf("expected %u got %u and %u (precomp)\n", expected, computed,
+                 precomp);
+          return false;
+        }
+      }
+    }
+    if (verbose)
+      printf("ok!\n");
+  }
+  if (verbose)
+    printf("mulmod test passed with moduli in interval [%u, %u].\n", min,
+           max);
+  return true;
+}
+
+// (a * b) % p by doubling and adding, the reference for mulmod_u64
+static uint64_t slowmulmod64(uint64_t a, uint64_t b, uint64_t p) {
+  uint64_t r = 0;
+  a %= p;
+  for (int bit = 63; bit >= 0; bit--) {
+    r = r >= p - r ? r - (p - r) : r + r;
+    if ((b >> bit) & 1)
+      r = r >= p - a ? r - (p - a) : r + a;
+  }
+  return r;
+}
+
+static bool slowisprime(uint64_t n) {
+  if (n < 2)
+    return false;
+  for (uint64_t k = 2; k * k <= n; k++) {
+    if (n % k == 0)
+      return false;
+  }
+  return true;
+}
+
+bool testmulmod64(uint64_t min, uint64_t max, bool verbose) {
+  for (uint64_t p = min; (p <= max) && (p >= min); p++) {
+    if (p < 2) {
+      printf("skipping p = %" PRIu64 " as mulmod does not support it\n", p);
+      continue;
+    }
+    if (verbose)
+      printf("p = %" PRIu64 " (mulmod_u64) ", p);
+    else
+      printf(".");
+    fflush(NULL);
+    __uint128_t M = computeM_u64(p);
+    uint64_t x = p;
+    for (int i = 0; i < 0x100; i++) {
+      x = x * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+      uint64_t a = (x >> 7) % p;
+      uint64_t b = x;
+      if (i == 0) {
+        a = p - 1;
+        b = UINT64_MAX;
+      }
+      uint64_t expected = slowmulmod64(a, b, p);
+      uint64_t computed = mulmod_u64(a, b, M, p);
+      // a ^ 3 computed two ways
+      uint64_t cube = slowmulmod64(slowmulmod64(a, a, p), a, p);
+      if ((computed != expected) || (powmod_u64(a, 3, M, p) != cube)) {
+        printf("(bad mulmod_u64) problem with modulus %" PRIu64
+               " and factors %" PRIu64 " %" PRIu64 "\n",
+               p, a, b);
+        printf("expected %" PRIu64 " got %" PRIu64 "\n", expected, computed);
+        return false;
+      }
+      if ((p >> 32) == 0) {
+        uint64_t M32 = computeM_u32((uint32_t)p);
+        if (powmod_u32((uint32_t)a, 3, M32, (uint32_t)p) != cube) {
+          printf("(bad powmod_u32) problem with modulus %" PRIu64
+                 " and base %" PRIu64 "\n",
+                 p, a);
+          return false;
+        }
+      }
+    }
+    if (verbose)
+      printf("ok!\n");
+    if (p == max)
+      break; // p++ would overflow
+  }
+  if (verbose)
+    printf("mulmod_u64 test passed with moduli in interval [%" PRIu64
+           ", %" PRIu64 "].\n",
+           min, max);
+  return true;
+}
+
+bool testprime(bool verbose) {
+  for (uint32_t n = 0; n < 0x10000; n++) {
+    if ((is_prime_u32(n) != slowisprime(n)) ||
+        (is_prime_u64(n) != slowisprime(n))) {
+      printf("(bad is_prime) problem with %u\n", n);
+      return false;
+    }
+  }
+  // strong pseudoprimes to some of the bases and their neighbours
+  const uint64_t composites[] = {UINT64_C(3215031751),
+                                 UINT64_C(4759123141),
+                                 UINT64_C(1122004669633),
+                                 UINT64_C(3825123056546413051),
+                                 UINT64_C(318665857834031151) * 3,
+                                 UINT64_C(4294967291) * 4294967279u,
+                                 UINT64_C(4294967291) * 4294967291u,
+                                 UINT64_MAX};
+  const uint64_t primes[] = {UINT64_C(2147483647),
+                             UINT64_C(4294967291),
+                             UINT64_C(4294967311),
+                             UINT64_C(2305843009213693951),
+                             UINT64_C(9223372036854775783),
+                             UINT64_C(18446744073709551557)};
+  for (size_t i = 0; i < sizeof(composites) / sizeof(composites[0]); i++) {
+    if (is_prime_u64(composites[i]) ||
+        ((composites[i] >> 32) == 0 && is_prime_u32((uint32_t)composites[i]))) {
+      printf("(bad is_prime) %" PRIu64 " is composite\n", composites[i]);
+      return false;
+    }
+  }
+  for (size_t i = 0; i < sizeof(primes) / sizeof(primes[0]); i++) {
+    if (!is_prime_u64(primes[i]) ||
+        ((primes[i] >> 32) == 0 && !is_prime_u32((uint32_t)primes[i]))) {
+      printf("(bad is_prime) %" PRIu64 " is prime\n", primes[i]);
+      return false;
+    }
+  }
+  // around 2^32, trial division stays cheap enough
+  for (uint64_t n = UINT64_C(0xffffff00); n < UINT64_C(0x100000100); n++) {
+    if (is_prime_u64(n) != slowisprime(n)) {
+      printf("(bad is_prime) problem with %" PRIu64 "\n", n);
+      return false;
+    }
+  }
+  if (verbose)
+    printf("is_prime test passed.\n");
+  return true;
+}
+
+bool testbatchunsigned(uint32_t min, uint32_t max, bool verbose) {
+  // an odd size so that the tail of every kernel gets exercised
+  enum { N = 1003 };
+  uint32_t in[N];
+  uint32_t out[N];
+  for (size_t i = 0; i < N; i++) {
+    in[i] = (uint32_t)(i * UINT64_C(0x9E3779B97F4A7C15) >> 32);
+  }
+  in[0] = 0;
+  in[1] = 1;
+  in[2] = UINT32_MAX;
+  in[3] = UINT32_MAX - 1;
+  for (uint32_t d = min; (d <= max) && (d >= min); d++) {
+    if (d == 0) {
+      printf("skipping d = 0\n");
+      continue;
+    }
+    uint64_t M = computeM_u32(d);
+    if (verbose)
+      printf("d = %u (unsigned batch) ", d);
+    else
+      printf(".");
+    fflush(NULL);
+    in[4] = d;
+    in[5] = d - 1;
+    fastmod_u32_batch(in, out, N, M, d);
+    for (size_t i = 0; i < N; i++) {
+      if (out[i] != in[i] % d) {
+        printf("(bad fastmod_u32_batch) problem with divisor %u and "
+               "dividend %u \n",
+               d, in[i]);
+        printf("expected %u mod %u = %u \n", in[i], d, in[i] % d);
+        printf("got %u mod %u = %u \n", in[i], d, out[i]);
+        return false;
+      }
+    }
+    fastmod_u32_batch_portable(in, out, N, M, d);
+    for (size_t i = 0; i < N; i++) {
+      if (out[i] != in[i] % d) {
+        printf("(bad fastmod_u32_batch_portable) problem with divisor %u and "
+               "dividend %u \n",
+               d, in[i]);
+        printf("expected %u mod %u = %u \n", in[i], d, in[i] % d);
+        printf("got %u mod %u = %u \n", in[i], d, out[i]);
+        return false;
+      }
+    }
+    if (d == 1)
+      continue; // fastdiv does not support d = 1
+    fastdiv_u32_batch(in, out, N, M);
+    for (size_t i = 0; i < N; i++) {
+      if (out[i] != in[i] / d) {
+        printf("(bad fastdiv_u32_batch) problem with divisor %u and "
+               "dividend %u \n",
+               d, in[i]);
+        printf("expected %u div %u = %u \n", in[i], d, in[i] / d);
+        printf("got %u div %u = %u \n", in[i], d, out[i]);
+        return false;
+      }
+    }
+    fastdiv_u32_batch_portable(in, out, N, M);
+    for (size_t i = 0; i < N; i++) {
+      if (out[i] != in[i] / d) {
+        printf("(bad fastdiv_u32_batch_portable) problem with divisor %u and "
+               "dividend %u \n",
+               d, in[i]);
+        printf("expected %u div %u = %u \n", in[i], d, in[i] / d);
+        printf("got %u div %u = %u \n", in[i], d, out[i]);
+        return false;
+      }
+    }
+    if (verbose)
+      printf("ok!\n");
+  }
+  if (verbose)
+    printf("Unsigned batch test passed with divisors in interval [%u, %u].\n",
+           min, max);
+  return true;
+}
+
+bool testbatchdivisible(uint32_t min, uint32_t max, bool verbose) {
+  enum { N = 1003 };
+  uint32_t in[N];
+  uint64_t bits[(N + 63) / 64];
+  for (size_t i = 0; i < N; i++) {
+    in[i] = (uint32_t)(i * UINT64_C(0x9E3779B97F4A7C15) >> 32);
+  }
+  in[0] = 0;
+  in[1] = 1;
+  in[2] = UINT32_MAX;
+  in[3] = UINT32_MAX - 1;
+  for (uint32_t d = min; (d <= max) && (d >= min); d++) {
+    if (d == 0) {
+      printf("skipping d = 0\n");
+      continue;
+    }
+    uint64_t M = computeM_u32(d);
+    if (verbose)
+      printf("d = %u (divisibility batch) ", d);
+    else
+      printf(".");
+    fflush(NULL);
+    in[4] = d;
+    in[5] = d - 1;
+    for (size_t i = 6; i < 70; i++) {
+      in[i] = d * (uint32_t)i; // many multiples, wrapping around
+    }
+    memset(bits, 0xFF, sizeof(bits));
+    is_divisible_u32_batch(in, bits, N, M);
+    for (size_t i = 0; i < 64 * ((N + 63) / 64); i++) {
+      bool expected = (i < N) && (in[i] % d == 0);
+      if (((bits[i / 64] >> (i % 64)) & 1) != expected) {
+        printf("(bad is_divisible_u32_batch) problem with divisor %u and "
+               "position %zu \n",
+               d, i);
+        return false;
+      }
+    }
+    // start + N must not exceed 2^32
+    const uint32_t last = (uint32_t)(UINT64_C(0x100000000) - N);
+    const uint32_t starts[4] = {0, d - 1 < last ? d - 1 : d - N, 0x7fffffff,
+                                last};
+    for (size_t k = 0; k < 4; k++) {
+      memset(bits, 0, sizeof(bits));
+      bits[0] = 2; // the range function must leave set bits alone
+      mark_divisible_u32_range(starts[k], bits, N, M);
+      for (size_t i = 0; i < 64 * ((N + 63) / 64); i++) {
+        bool expected =
+            (i == 1) || ((i < N) && ((starts[k] + (uint32_t)i) % d == 0));
+        if (((bits[i / 64] >> (i % 64)) & 1) != expected) {
+          printf("(bad mark_divisible_u32_range) problem with divisor %u, "
+                 "start %u and position %zu \n",
+                 d, starts[k], i);
+          return false;
+        }
+      }
+    }
+    if (verbose)
+      printf("ok!\n");
+  }
+  if (verbose)
+    printf("Divisibility batch test passed with divisors in interval [%u, "
+           "%u].\n",
+           min, max);
+  return true;
+}
+
+bool testsieve(bool verbose) {
+  // primes below 2^16 are enough to sieve the 32-bit integers
+  enum { N = 5000 };
+  static uint64_t M[6542];
+  uint64_t bits[(N + 63) / 64];
+  size_t count = 0;
+  for (uint32_t p = 2; p < 0x10000; p++) {
+    if (is_prime_u32(p))
+      M[count++] = computeM_u32(p);
+  }
+  const uint32_t starts[3] = {0x10000, 0x7fffff00,
+                              (uint32_t)(UINT64_C(0x100000000) - N)};
+  for (size_t k = 0; k < 3; k++) {
+    sieve_u32_segment(starts[k], bits, N, M, count);
+    for (uint32_t j = 0; j < N; j++) {
+      bool isprime = ((bits[j / 64] >> (j % 64)) & 1) == 0;
+      if (isprime != is_prime_u32(starts[k] + j)) {
+        printf("(bad sieve_u32_segment) problem with %u\n", starts[k] + j);
+        return false;
+      }
+    }
+  }
+  if (verbose)
+    printf("sieve test passed.\n");
+  return true;
+}
+
+bool testmulti(bool verbose) {
+  enum { N = 1003 };
+  uint32_t in[N];
+  static uint32_t out[N * FASTMOD_MULTI_MAX + 1];
+  uint32_t d[FASTMOD_MULTI_MAX];
+  for (size_t i = 0; i < N; i++) {
+    in[i] = (uint32_t)(i * UINT64_C(0x9E3779B97F4A7C15) >> 32);
+  }
+  in[0] = 0;
+  in[1] = 1;
+  in[2] = UINT32_MAX;
+  in[3] = UINT32_MAX - 1;
+  for (size_t k = 0; k < FASTMOD_MULTI_MAX; k++) {
+    d[k] = (uint32_t)((k + 1) * UINT64_C(0xC2B2AE3D27D4EB4F) >> 40) + 1;
+  }
+  d[0] = 1;
+  d[3] = UINT32_MAX;
+  d[5] = 2;
+  d[7] = 0x80000001;
+  for (size_t count = 0; count <= FASTMOD_MULTI_MAX; count++) {
+    fastmod_u32_multi_t m;
+    fastmod_u32_multi_init(&m, d, count);
+    if (verbose)
+      printf("count = %zu (multi) ", count);
+    else
+      printf(".");
+    fflush(NULL);
+    // one past the end must be left alone
+    out[N * count] = 12345;
+    fastmod_u32_multi_batch(&m, in, N, out);
+    for (size_t i = 0; i < N; i++) {
+      for (size_t k = 0; k < count; k++) {
+        if (out[i * count + k] != in[i] % d[k]) {
+          printf("(bad fastmod_u32_multi_batch) problem with divisor %u and "
+                 "dividend %u \n",
+                 d[k], in[i]);
+          printf("expected %u mod %u = %u \n", in[i], d[k], in[i] % d[k]);
+          printf("got %u mod %u = %u \n", in[i], d[k], out[i * count + k]);
+          return false;
+        }
+      }
+    }
+    if (out[N * count] != 12345) {
+      printf("(bad fastmod_u32_multi_batch) wrote past the end with %zu "
+             "divisors\n",
+             count);
+      return false;
+    }
+    fastmod_u32_multi(&m, in[2], out);
+    for (size_t k = 0; k < count; k++) {
+      if (out[k] != in[2] % d[k]) {
+        printf("(bad fastmod_u32_multi) problem with divisor %u\n", d[k]);
+        return false;
+      }
+    }
+    if (verbose)
+      printf("ok!\n");
+  }
+  // a larger count is clamped, the extra divisors are not read
+  fastmod_u32_multi_t m;
+  fastmod_u32_multi_init(&m, d, FASTMOD_MULTI_MAX + 1000);
+  if (m.count != FASTMOD_MULTI_MAX) {
+    printf("(bad fastmod_u32_multi_init) count %zu was not clamped\n",
+           m.count);
+    return false;
+  }
+  if (verbose)
+    printf("Multi-divisor test passed.\n");
+  return true;
+}
+
+bool testcomputeM(uint32_t min, uint32_t max, bool verbose) {
+  enum { N = 1003 };
+  uint32_t d[N];
+  uint64_t M[N];
+  uint64_t Mscalar[N];
+  uint32_t next = min;
+  bool done = false;
+  while (!done) {
+    size_t n = 0;
+    while (n < N && !done) {
+      d[n++] = next;
+      done = (next == max);
+      next++;
+    }
+    computeM_u32_batch(d, M, n);
+    computeM_u32_batch_scalar(d, Mscalar, n);
+    for (size_t i = 0; i < n; i++) {
+      uint64_t expected = computeM_u32(d[i]);
+      if (computeM_u32_nodiv(d[i]) != expected) {
+        printf("(bad computeM_u32_nodiv) problem with divisor %u\n", d[i]);
+        return false;
+      }
+      if (M[i] != expected || Mscalar[i] != expected) {
+        printf("(bad computeM_u32_batch) problem with divisor %u\n", d[i]);
+        return false;
+      }
+    }
+  }
+  if (verbose)
+    printf("computeM test passed with divisors in interval [%u, %u].\n", min,
+           max);
+  return true;
+}
+
+#ifndef _MSC_VER
+// computeM_u64 and computeM_u64_nodiv are the 128-bit division, d > 0
+bool checkcomputeM64(uint64_t d) {
+  __uint128_t expected = ((__uint128_t)0 - 1) / d + 1;
+  if (computeM_u64(d) != expected) {
+    printf("(bad computeM_u64) problem with divisor %" PRIu64 "\n", d);
+    return false;
+  }
+  if (computeM_u64_nodiv(d) != expected) {
+    printf("(bad computeM_u64_nodiv) problem with divisor %" PRIu64 "\n", d);
+    return false;
+  }
+  return true;
+}
+
+// the divisors in [min, max] and count pseudo-random divisors
+bool testcomputeM64(uint64_t min, uint64_t max, size_t count, bool verbose) {
+  for (uint64_t d = min; (d <= max) && (d >= min); d++) {
+    if (d != 0 && !checkcomputeM64(d))
+      return false;
+    if (d == max)
+      break;
+  }
+  uint64_t x = UINT64_C(0x9E3779B97F4A7C15);
+  for (size_t i = 0; i < count; i++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    uint64_t d = x >> (x % 64); // all magnitudes
+    if (d != 0 && !checkcomputeM64(d))
+      return false;
+  }
+  if (verbose)
+    printf("computeM_u64_nodiv test passed with divisors in interval [%" PRIu64
+           ", %" PRIu64 "] and %zu others.\n",
+           min, max, count);
+  return true;
+}
+#endif
+
+bool testdispatch(bool verbose) {
+  enum { N = 1003 };
+  uint32_t in[N];
+  uint32_t out[N];
+  uint64_t bits[(N + 63) / 64];
+  const char *initial = fastmod_dispatch_name();
+  for (size_t i = 0; i < N; i++) {
+    in[i] = (uint32_t)(i * UINT64_C(0x9E3779B97F4A7C15) >> 32);
+  }
+  in[0] = 0;
+  in[1] = 1;
+  in[2] = UINT32_MAX;
+  const fastmod_dispatch_t *kernel;
+  for (int k = 0; (kernel = fastmod_dispatch_kernel(k)) != NULL; k++) {
+    if (!fastmod_dispatch_select(kernel->name)) {
+      if (fastmod_dispatch_supported(k)) {
+        printf("(bad fastmod_dispatch_select) cannot select %s\n",
+               kernel->name);
+        return false;
+      }
+      if (verbose)
+        printf("%s is not supported, skipping\n", kernel->name);
+      continue;
+    }
+    if (strcmp(fastmod_dispatch_name(), kernel->name) != 0) {
+      printf("(bad fastmod_dispatch_name) expected %s\n", kernel->name);
+      return false;
+    }
+    const uint32_t divisors[6] = {1, 2, 3, 7, 0x7fffffff, UINT32_MAX};
+    uint64_t Ms[6];
+    kernel->computeM_u32(divisors, Ms, 6);
+    for (size_t j = 0; j < 6; j++) {
+      if (Ms[j] != computeM_u32(divisors[j])) {
+        printf("(bad computeM_u32 kernel) %s: problem with divisor %u\n",
+               kernel->name, divisors[j]);
+        return false;
+      }
+    }
+    for (size_t j = 0; j < 6; j++) {
+      uint32_t d = divisors[j];
+      uint64_t M = computeM_u32(d);
+      in[3] = d;
+      fastmod_u32_batch_dispatch(in, out, N, M, d);
+      for (size_t i = 0; i < N; i++) {
+        if (out[i] != in[i] % d) {
+          printf("(bad fastmod_u32_batch_dispatch) %s: problem with divisor "
+                 "%u and dividend %u \n",
+                 kernel->name, d, in[i]);
+          return false;
+        }
+      }
+      is_divisible_u32_batch_dispatch(in, bits, N, M);
+      for (size_t i = 0; i < N; i++) {
+        if (((bits[i / 64] >> (i % 64)) & 1) != (in[i] % d == 0)) {
+          printf("(bad is_divisible_u32_batch_dispatch) %s: problem with "
+                 "divisor %u and dividend %u \n",
+                 kernel->name, d, in[i]);
+          return false;
+        }
+      }
+      if (d == 1)
+        continue; // fastdiv does not support d = 1
+      fastdiv_u32_batch_dispatch(in, out, N, M);
+      for (size_t i = 0; i < N; i++) {
+        if (out[i] != in[i] / d) {
+          printf("(bad fastdiv_u32_batch_dispatch) %s: problem with divisor "
+                 "%u and dividend %u \n",
+                 kernel->name, d, in[i]);
+          return false;
+        }
+      }
+    }
+    if (verbose)
+      printf("%s kernel ok!\n", kernel->name);
+  }
+  if (fastmod_dispatch_select("no such kernel")) {
+    printf("(bad fastmod_dispatch_select) accepted an unknown kernel\n");
+    return false;
+  }
+  fastmod_dispatch_select(initial);
+  if (verbose)
+    printf("Dispatch test passed, the default kernel is %s.\n", initial);
+  return true;
+}
+
+bool testbatchunsigned64(uint64_t min, uint64_t max, bool verbose) {
+  enum { N = 1003 };
+  uint64_t in[N];
+  uint64_t out[N];
+  for (size_t i = 0; i < N; i++) {
+    in[i] = (uint64_t)(i + 1) * UINT64_C(0x9E3779B97F4A7C15);
+  }
+  in[0] = 0;
+  in[1] = 1;
+  in[2] = UINT64_MAX;
+  in[3] = UINT64_MAX - 1;
+  for (uint64_t d = min; (d <= max) && (d >= min); d++) {
+    if (d == 0) {
+      printf("skipping d = 0\n");
+      continue;
+    }
+    __uint128_t M64 = computeM_u64(d);
+    if (verbose)
+      printf("d = %" PRIu64 " (unsigned 64-bit batch) ", d);
+    else
+      printf(".");
+    fflush(NULL);
+    in[4] = d;
+    in[5] = d - 1;
+    in[6] = d + 1;
+    fastmod_u64_batch(in, out, N, M64, d);
+    for (size_t i = 0; i < N; i++) {
+      if (out[i] != in[i] % d) {
+        printf("(bad fastmod_u64_batch) problem with divisor %" PRIu64
+               " and dividend %" PRIu64 " \n",
+               d, in[i]);
+        printf("expected %" PRIu64 " mod %" PRIu64 " = %" PRIu64 " \n", in[i],
+               d, in[i] % d);
+        printf("got %" PRIu64 " mod %" PRIu64 " = %" PRIu64 " \n", in[i], d,
+               out[i]);
+        return false;
+      }
+    }
+    if (d == 1)
+      continue; // fastdiv does not support d = 1
+    fastdiv_u64_batch(in, out, N, M64);
+    for (size_t i = 0; i < N; i++) {
+      if (out[i] != in[i] / d) {
+        printf("(bad fastdiv_u64_batch) problem with divisor %" PRIu64
+               " and dividend %" PRIu64 " \n",
+               d, in[i]);
+        printf("expected %" PRIu64 " div %" PRIu64 " = %" PRIu64 " \n", in[i],
+               d, in[i] / d);
+        printf("got %" PRIu64 " div %" PRIu64 " = %" PRIu64 " \n", in[i], d,
+               out[i]);
+        return false;
+      }
+    }
+    if (verbose)
+      printf("ok!\n");
+  }
+  if (verbose)
+    printf("Unsigned 64-bit batch test passed with divisors in interval "
+           "[%" PRIu64 ", %" PRIu64 "].\n",
+           min, max);
+  return true;
+}
+
+bool testunsigned64by32(uint32_t min, uint32_t max, bool verbose) {
+  // dividends are checked in windows at the bottom, the top and around the
+  // powers of two in-between
+  const uint64_t window = 0x4000;
+  for (uint32_t d = min; (d <= max) && (d >= min); d++) {
+    if (d <= 1) {
+      printf("skipping d = %u as it is not supported\n", d);
+      continue;
+    }
+    uint64_t M = computeM_u32(d);
+    if (verbose)
+      printf("d = %u (64-bit by 32-bit) ", d);
+    else
+      printf(".");
+    fflush(NULL);
+    for (int shift = 0; shift <= 64; shift += 4) {
+      uint64_t start = UINT64_MAX - window + 1;
+      if (shift < 64) {
+        uint64_t center = UINT64_C(1) << shift;
+        start = center > window / 2 ? center - window / 2 : 0;
+      }
+      for (uint64_t i = 0; i < window; i++) {
+        uint64_t a = start + i;
+        uint64_t computedMod = fastmod_u64_u32(a, M, d);
+        uint64_t computedDiv = fastdiv_u64_u32(a, M, d);
+        uint32_t fusedMod;
+        uint64_t fusedDiv = fastdivmod_u64_u32(a, M, d, &fusedMod);
+        if ((computedMod != a % d) || (computedDiv != a / d) ||
+            (fusedMod != computedMod) || (fusedDiv != computedDiv)) {
+          printf("(bad fastmod_u64_u32) problem with divisor %u and dividend "
+                 "%" PRIu64 " \n",
+                 d, a);
+          printf("expected %" PRIu64 " mod %u = %" PRIu64 " \n", a, d, a % d);
+          printf("got %" PRIu64 " mod %u = %" PRIu64 " \n", a, d, computedMod);
+          printf("expected %" PRIu64 " div %u = %" PRIu64 " \n", a, d, a / d);
+          printf("got %" PRIu64 " div %u = %" PRIu64 " \n", a, d, computedDiv);
+          return false;
+        }
+      }
+    }
+    if (verbose)
+      printf("ok!\n");
+  }
+  if (verbose)
+    printf("64-bit by 32-bit test passed with divisors in interval [%u, %u].\n",
+           min, max);
+  return true;
+}
+
+// a - floor(a / d) * d and floor(a / d), the reference for the floor
+// variants
+static int64_t floormod64(int64_t a, int64_t d) {
+  int64_t r = a % d;
+  return (r != 0 && ((r < 0) != (d < 0))) ? r + d : r;
+}
+static int64_t floordiv64(int64_t a, int64_t d) {
+  int64_t r = a % d;
+  return a / d - ((r != 0 && ((r < 0) != (d < 0))) ? 1 : 0);
+}
+
+bool testsigned64(int64_t min, int64_t max, bool verbose) {
+  // dividends are checked in windows around 0, around plus or minus every
+  // fourth power of two and at both ends of the range
+  const int64_t window = 0x1000;
+  for (int64_t d = min; (d <= max) && (d >= min); d++) {
+    if (d == 0) {
+      printf("skipping d = 0 as it cannot be supported\n");
+      continue;
+    }
+    if (d == INT64_MIN) {
+      printf("skipping d = -9223372036854775808 as it is unsupported\n");
+      continue;
+    }
+    __uint128_t M = computeM_s64(d);
+    int64_t positive_d = d < 0 ? -d : d;
+    if (verbose)
+      printf("d = %" PRId64 " (signed 64-bit) ", d);
+    else
+      printf(".");
+    fflush(NULL);
+    for (int shift = -1; shift <= 64; shift += 4) {
+      for (int sign = -1; sign <= 1; sign += 2) {
+        int64_t start;
+        if (shift < 0) {
+          start = -window / 2;
+        } else if (shift >= 63) {
+          start = sign < 0 ? INT64_MIN : INT64_MAX - window + 1;
+        } else {
+          start = sign * (INT64_C(1) << shift) - window / 2;
+        }
+        for (int64_t i = 0; i < window; i++) {
+          int64_t a = start + i;
+          if (d == -1 && a == INT64_MIN)
+            continue; // otherwise, result is undefined
+          if ((fastmod_s64(a, M, positive_d) != a % d) ||
+              (fastmod_floor_s64(a, M, d) != floormod64(a, d))) {
+            printf("(bad signed 64-bit fastmod) problem with divisor "
+                   "%" PRId64 " and dividend %" PRId64 " \n",
+                   d, a);
+            printf("expected %" PRId64 " mod %" PRId64 " = %" PRId64 " \n", a,
+                   d, a % d);
+            printf("got %" PRId64 " mod %" PRId64 " = %" PRId64 " \n", a, d,
+                   fastmod_s64(a, M, positive_d));
+            return false;
+          }
+          if (positive_d == 1)
+            continue; // fastdiv does not support -1 and 1
+          int64_t fusedMod;
+          int64_t fusedDiv = fastdivmod_s64(a, M, d, &fusedMod);
+          if ((fastdiv_s64(a, M, d) != a / d) ||
+              (fastdiv_floor_s64(a, M, d) != floordiv64(a, d)) ||
+              (fusedDiv != a / d) || (fusedMod != a % d)) {
+            printf("(bad signed 64-bit fastdiv) problem with divisor "
+                   "%" PRId64 " and dividend %" PRId64 " \n",
+                   d, a);
+            printf("expected %" PRId64 " div %" PRId64 " = %" PRId64 " \n", a,
+                   d, a / d);
+            printf("got %" PRId64 " div %" PRId64 " = %" PRId64 " \n", a, d,
+                   fastdiv_s64(a, M, d));
+            return false;
+          }
+        }
+      }
+    }
+    if (verbose)
+      printf("ok!\n");
+    if (d == max)
+      break; // d++ would overflow
+  }
+  if (verbose)
+    printf("Signed 64-bit test passed with divisors in interval "
+           "[%" PRId64 ", %" PRId64 "].\n",
+           min, max);
+  return true;
+}
+
 int main(int argc, char *argv[]) {
   bool isok = true;
   bool verbose = false;
@@ -229,6 +1129,8 @@ int main(int argc, char *argv[]) {
   isok = isok && testunsigned64(1, 0x10, verbose);
   isok = isok && testunsigned64(0x000133F, 0xFFFF, verbose);
   isok = isok && testunsigned64(UINT64_C(0xffffffffff00000), UINT64_C(0xffffffffff00000) + 0x100, verbose);
+  isok = isok && testunsigned64by32(1, 0x100, verbose);
+  isok = isok && testunsigned64by32(0xffffff00, 0xffffffff, verbose);
   isok = isok && testunsigned(1, 8, verbose);
   isok = isok && testunsigned(0xfffffff8, 0xffffffff, verbose);
   isok = isok && testdivsigned(INT32_MIN, -0x7ffffff8, verbose);
@@ -239,6 +1141,51 @@ int main(int argc, char *argv[]) {
   isok = isok && testdivunsigned(2, 10, verbose);
   isok = isok && testdivunsigned(0xfffffff8, 0xffffffff, verbose);
 
+  isok = isok && testdivmod(1, 0x100, verbose);
+  isok = isok && testdivmod(0x7fffff00, 0x800000ff, verbose);
+  isok = isok && testdivmod(0xffffff00, 0xffffffff, verbose);
+
+  isok = isok && testfastrange(1, 0x100, verbose);
+  isok = isok && testfastrange(0xffffff00, 0xffffffff, verbose);
+
+  isok = isok && testmulmod(1, 0x400, verbose);
+  isok = isok && testmulmod(0x7fffff00, 0x800000ff, verbose);
+  isok = isok && testmulmod(0xfffffc00, 0xffffffff, verbose);
+  isok = isok && testmulmod64(1, 0x400, verbose);
+  isok = isok && testmulmod64(UINT64_C(0xfffffffffffffc00),
+                              UINT64_C(0xffffffffffffffff), verbose);
+  isok = isok && testmulmod64(UINT64_C(0x7ffffffffffffe00),
+                              UINT64_C(0x80000000000001ff), verbose);
+  isok = isok && testprime(verbose);
+
+  isok = isok && testbatchunsigned(1, 300, verbose);
+  isok = isok && testbatchunsigned(0xffffff00, 0xffffffff, verbose);
+  isok = isok && testbatchdivisible(1, 300, verbose);
+  isok = isok && testbatchdivisible(0xffffff00, 0xffffffff, verbose);
+  isok = isok && testsieve(verbose);
+  isok = isok && testmulti(verbose);
+  isok = isok && testcomputeM(1, 0x10000, verbose);
+  isok = isok && testcomputeM(0x7fff0000, 0x8000ffff, verbose);
+  isok = isok && testcomputeM(0xffff0000, 0xffffffff, verbose);
+#ifndef _MSC_VER
+  isok = isok && testcomputeM64(1, 0x10000, 1000000, verbose);
+  isok = isok && testcomputeM64(UINT64_C(0x7fffffffffff0000),
+                                UINT64_C(0x800000000000ffff), 0, verbose);
+  isok = isok && testcomputeM64(UINT64_C(0xffffffffffff0000),
+                                UINT64_C(0xffffffffffffffff), 0, verbose);
+#endif
+  isok = isok && testdispatch(verbose);
+  isok = isok && testbatchunsigned64(1, 300, verbose);
+  isok = isok && testbatchunsigned64(UINT64_C(0xffffffffff00000),
+                                     UINT64_C(0xffffffffff00000) + 0x100,
+                                     verbose);
+  isok = isok && testbatchunsigned64(UINT64_C(0xffffffffffffff00),
+                                     UINT64_C(0xffffffffffffffff), verbose);
+
+  isok = isok && testsigned64(-0x100, 0x100, verbose);
+  isok = isok && testsigned64(INT64_MAX - 0x10, INT64_MAX, verbose);
+  isok = isok && testsigned64(INT64_MIN, INT64_MIN + 0x10, verbose);
+
   isok = isok && testsigned(-8, -1, verbose);
   isok = isok && testsigned(1, 8, verbose);
   isok = isok && testsigned(0x7ffffff8, 0x7fffffff, verbose);
@@ -252,6 +1199,9 @@ int main(int argc, char *argv[]) {
     } else {
       isok = isok && testunsigned(x, x, verbose);
     }
+    isok = isok && testunsigned64by32(x, x, verbose);
+    int64_t y = ((int64_t)x << (k % 32)) * (k % 2 ? -1 : 1);
+    isok = isok && testsigned64(y, y, verbose);
   }
   printf("\n");
   if (isok) {
@@ -0,0 +1,285 @@
+#ifndef FASTMOD_TOOLS_PARTITION_H
+#define FASTMOD_TOOLS_PARTITION_H
+
+#include "fastmod.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace partition {
+
+/**
+ * Shards a file of fixed-width records into parts files by key % parts
+ * (POSIX).
+ * Usage:
+ *  partition::options opt;
+ *  opt.input = "keys.bin";
+ *  opt.output_prefix = "shard"; // writes shard.0, ..., shard.(parts - 1)
+ *  opt.width = 16; // bytes per record
+ *  opt.key_width = 8; // the key is the first 4 or 8 bytes of each record
+ *  opt.parts = 10;
+ *  partition::stats s;
+ *  std::string error = partition::partition_file(opt, &s); // empty if ok
+ *
+ * The input is memory-mapped and read once, in order. Keys are unsigned
+ * integers in the byte order of the machine and the bucket of a record is
+ * fastmod_u32(key, M, parts) or fastmod_u64_u32(key, M, parts). Records are
+ * appended to a buffer per partition, which is written out with one write
+ * call when it is full, so each output file keeps the order of the input.
+ **/
+
+struct options {
+  const char *input = nullptr;
+  const char *output_prefix = nullptr;
+  size_t width = 8;
+  size_t key_width = 8;
+  uint32_t parts = 1;
+  // bytes buffered per partition (at least one record), 0 picks at most
+  // 64 MB in total
+  size_t buffer_size = 0;
+};
+
+struct stats {
+  uint64_t records = 0;
+  uint64_t bytes = 0;
+  double seconds = 0;
+};
+
+// the name of partition k
+inline std::string partition_path(const char *prefix, uint32_t k) {
+  return std::string(prefix) + "." + std::to_string(k);
+}
+
+inline std::string system_error(const std::string &what) {
+  return what + ": " + strerror(errno);
+}
+
+// writes all of data, returns false and sets errno on failure
+inline bool write_all(int fd, const uint8_t *data, size_t length) {
+  while (length > 0) {
+    ssize_t written = write(fd, data, length);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    length -= size_t(written);
+  }
+  return true;
+}
+
+class partition_writer {
+public:
+  partition_writer(int file, size_t capacity)
+      : fd(file), buffer(capacity), used(0) {}
+  partition_writer(partition_writer &&other)
+      : fd(other.fd), buffer(std::move(other.buffer)), used(other.used) {
+    other.fd = -1;
+  }
+  partition_writer(const partition_writer &) = delete;
+  partition_writer &operator=(const partition_writer &) = delete;
+  ~partition_writer() {
+    if (fd >= 0)
+      close(fd);
+  }
+
+  bool append(const uint8_t *record, size_t width) {
+    if (used + width > buffer.size() && !flush())
+      return false;
+    memcpy(buffer.data() + used, record, width);
+    used += width;
+    return true;
+  }
+
+  bool flush() {
+    if (!write_all(fd, buffer.data(), used))
+      return false;
+    used = 0;
+    return true;
+  }
+
+  bool finish() {
+    bool ok = flush();
+    ok = (close(fd) == 0) && ok;
+    fd = -1;
+    return ok;
+  }
+
+private:
+  int fd;
+  std::vector<uint8_t> buffer;
+  size_t used;
+};
+
+// W is the record width when it is known at compile time, 0 otherwise
+template <size_t W, typename Bucket>
+std::string scatter(const uint8_t *data, size_t records, size_t width,
+                    Bucket bucket, std::vector<partition_writer> &writers) {
+  const size_t w = W != 0 ? W : width;
+  for (size_t i = 0; i < records; i++) {
+    const uint8_t *record = data + i * w;
+    if (!writers[bucket(record)].append(record, w))
+      return system_error("cannot write a partition");
+  }
+  return std::string();
+}
+
+// the common widths get a copy of constant size instead of a call to memcpy
+template <typename Bucket>
+std::string scatter(const uint8_t *data, size_t records, size_t width,
+                    Bucket bucket, std::vector<partition_writer> &writers) {
+  switch (width) {
+  case 4:
+    return scatter<4>(data, records, width, bucket, writers);
+  case 8:
+    return scatter<8>(data, records, width, bucket, writers);
+  case 16:
+    return scatter<16>(data, records, width, bucket, writers);
+  default:
+    return scatter<0>(data, records, width, bucket, writers);
+  }
+}
+
+inline std::string partition_file(const options &opt, stats *s) {
+  if (opt.input == nullptr || opt.output_prefix == nullptr)
+    return "missing input or output";
+  if (opt.parts == 0)
+    return "the number of partitions must be positive";
+  if ((opt.key_width != 4 && opt.key_width != 8) || opt.width < opt.key_width)
+    return "the key must be 4 or 8 bytes and fit in the record";
+  auto start = std::chrono::steady_clock::now();
+  int in = open(opt.input, O_RDONLY);
+  if (in < 0)
+    return system_error(opt.input);
+  struct stat st;
+  if (fstat(in, &st) != 0) {
+    std::string error = system_error(opt.input);
+    close(in);
+    return error;
+  }
+  const size_t length = size_t(st.st_size);
+  if (length % opt.width != 0) {
+    close(in);
+    return "the size of the input is not a multiple of the record width";
+  }
+  const uint8_t *data = nullptr;
+  if (length > 0) {
+    void *map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, in, 0);
+    if (map == MAP_FAILED) {
+      std::string error = system_error("cannot map the input");
+      close(in);
+      return error;
+    }
+    madvise(map, length, MADV_SEQUENTIAL);
+    data = static_cast<const uint8_t *>(map);
+  }
+  close(in); // the mapping stays valid
+
+  size_t capacity = opt.buffer_size;
+  if (capacity == 0) {
+    // 64 MB shared by the partitions, at most 1 MB each
+    capacity = (size_t(64) << 20) / opt.parts;
+    if (capacity > (size_t(1) << 20))
+      capacity = size_t(1) << 20;
+  }
+  if (capacity < opt.width)
+    capacity = opt.width;
+  std::vector<partition_writer> writers;
+  std::string error;
+  for (uint32_t k = 0; k < opt.parts && error.empty(); k++) {
+    std::string path = partition_path(opt.output_prefix, k);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      error = system_error(path);
+    else
+      writers.emplace_back(fd, capacity);
+  }
+
+  const size_t records = length / opt.width;
+  const uint32_t d = opt.parts;
+  if (!error.empty()) {
+    // could not create all the partitions
+  } else if (d == 1) {
+    error = scatter(data, records, opt.width,
+                    [](const uint8_t *) { return uint32_t(0); }, writers);
+  } else if (opt.key_width == 4) {
+    const uint64_t M = fastmod::computeM_u32(d);
+    error = scatter(data, records, opt.width,
+                    [M, d](const uint8_t *record) {
+                      uint32_t key;
+                      memcpy(&key, record, sizeof(key));
+                      return fastmod::fastmod_u32(key, M, d);
+                    },
+                    writers);
+  } else {
+    // parts has 32 bits, the 64-bit M of fastmod_u32 is enough
+    const uint64_t M = fastmod::computeM_u32(d);
+    error = scatter(data, records, opt.width,
+                    [M, d](const uint8_t *record) {
+                      uint64_t key;
+                      memcpy(&key, record, sizeof(key));
+                      return fastmod::fastmod_u64_u32(key, M, d);
+                    },
+                    writers);
+  }
+  for (partition_writer &w : writers) {
+    if (!w.finish() && error.empty())
+      error = system_error("cannot write a partition");
+  }
+  if (length > 0)
+    munmap(const_cast<uint8_t *>(data), length);
+  if (!error.empty())
+    return error;
+  auto end = std::chrono::steady_clock::now();
+  if (s != nullptr) {
+    s->records = records;
+    s->bytes = length;
+    s->seconds = std::chrono::duration<double>(end - start).count();
+  }
+  return std::string();
+}
+
+// writes records random records of width bytes to path
+inline std::string generate_file(const char *path, uint64_t records,
+                                 size_t width, uint64_t seed = 1234) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return system_error(path);
+  std::mt19937_64 mt(seed);
+  std::vector<uint8_t> buffer;
+  buffer.reserve(size_t(1) << 20);
+  for (uint64_t i = 0; i < records; i++) {
+    for (size_t j = 0; j < width; j += sizeof(uint64_t)) {
+      uint64_t x = mt();
+      size_t bytes = width - j < sizeof(x) ? width - j : sizeof(x);
+      const uint8_t *p = reinterpret_cast<const uint8_t *>(&x);
+      buffer.insert(buffer.end(), p, p + bytes);
+    }
+    if (buffer.size() >= (size_t(1) << 20) || i + 1 == records) {
+      if (!write_all(fd, buffer.data(), buffer.size())) {
+        std::string error = system_error(path);
+        close(fd);
+        return error;
+      }
+      buffer.clear();
+    }
+  }
+  if (close(fd) != 0)
+    return system_error(path);
+  return std::string();
+}
+
+} // partition
+
+#endif // FASTMOD_TOOLS_PARTITION_H